@@ -0,0 +1,773 @@
+/*
+ * User-level stubs for the Phase 2 system calls that are not in libuser.h, along with their
+ * system call numbers, types, and error codes.
+ */
+
+#ifndef _LIBUSER2_H
+#define _LIBUSER2_H
+
+#include <usloss.h>
+#include <phase1.h>
+#include "phase2.h"
+
+#define CHECKMODE2 { \
+    if (USLOSS_PsrGet() & USLOSS_PSR_CURRENT_MODE) { \
+        USLOSS_Console("Trying to invoke syscall from kernel\n"); \
+        USLOSS_Halt(1); \
+    } \
+}
+
+/*
+ * System call numbers for calls added in Phase 2 that are not in usyscall.h. They are allocated
+ * downward from the top of the system call vector so they don't collide with USLOSS's.
+ */
+
+#define SYS_DISKSYNC            (USLOSS_MAX_SYSCALLS - 1)
+#define SYS_DISKADVISE          (USLOSS_MAX_SYSCALLS - 2)
+#define SYS_DISKPREAD           (USLOSS_MAX_SYSCALLS - 3)
+#define SYS_DISKPWRITE          (USLOSS_MAX_SYSCALLS - 4)
+#define SYS_RWLOCKCREATE        (USLOSS_MAX_SYSCALLS - 5)
+#define SYS_RWLOCKFREE          (USLOSS_MAX_SYSCALLS - 6)
+#define SYS_RWLOCKACQUIRE       (USLOSS_MAX_SYSCALLS - 7)
+#define SYS_RWLOCKRELEASE       (USLOSS_MAX_SYSCALLS - 8)
+#define SYS_SEMCREATE           (USLOSS_MAX_SYSCALLS - 9)
+#define SYS_SEMFREE             (USLOSS_MAX_SYSCALLS - 10)
+#define SYS_SEMP                (USLOSS_MAX_SYSCALLS - 11)
+#define SYS_SEMV                (USLOSS_MAX_SYSCALLS - 12)
+#define SYS_BARRIERCREATE       (USLOSS_MAX_SYSCALLS - 13)
+#define SYS_BARRIERFREE         (USLOSS_MAX_SYSCALLS - 14)
+#define SYS_BARRIERWAIT         (USLOSS_MAX_SYSCALLS - 15)
+#ifndef SYS_CONDBROADCAST
+#define SYS_CONDBROADCAST       (USLOSS_MAX_SYSCALLS - 16)
+#endif
+#define SYS_LOCKSTATS           (USLOSS_MAX_SYSCALLS - 17)
+#define SYS_MAILBOXCREATE       (USLOSS_MAX_SYSCALLS - 18)
+#define SYS_MAILBOXFREE         (USLOSS_MAX_SYSCALLS - 19)
+#define SYS_MAILBOXSEND         (USLOSS_MAX_SYSCALLS - 20)
+#define SYS_MAILBOXRECEIVE      (USLOSS_MAX_SYSCALLS - 21)
+#define SYS_LOCKLOOKUP          (USLOSS_MAX_SYSCALLS - 22)
+#define SYS_WAITEVENTS          (USLOSS_MAX_SYSCALLS - 23)
+#define SYS_GETALLPROCINFO      (USLOSS_MAX_SYSCALLS - 24)
+
+/*
+ * Error codes added in Phase 2, after those in phase2.h.
+ */
+
+#define P2_INVALID_ARGUMENT     -31
+#define P2_SWAP_FULL            -32
+#define P2_WOULD_BLOCK          -33
+#define P2_TOO_MANY_OBJECTS     -34
+#define P2_BUFFER_TOO_SMALL     -35
+
+/*
+ * Information about one process, returned by Sys_GetAllProcInfo.
+ */
+typedef struct P2_ProcInfo {
+    int         pid;
+    P1_ProcInfo info;
+} P2_ProcInfo;
+
+/*
+ * Access pattern hints for Sys_DiskAdvise.
+ */
+
+#define P2_ADVISE_NORMAL        0   // no hint, clears previous hints for the range
+#define P2_ADVISE_SEQUENTIAL    1   // read once in order, e.g. a scan
+#define P2_ADVISE_RANDOM        2   // read in no particular order, don't read ahead
+#define P2_ADVISE_WILLNEED      3   // will be read soon, read it now and keep it cached
+#define P2_ADVISE_DONTNEED      4   // won't be read again, drop it from the cache
+
+/*
+ * Lock words in P2_LockWords, one per lock. The word of a held lock is P2_LOCK_WORD of the
+ * holder's pid, with P2_LOCK_WAITERS set if the holder must release it through the kernel. A
+ * process acquires a free lock without a system call by atomically changing its word from
+ * P2_LOCK_FREE to P2_LOCK_WORD(pid), and releases it by changing it back. Any other transition
+ * goes through the kernel, which checks the holder's pid.
+ */
+
+#define P2_LOCK_INVALID         -1  // no such lock
+#define P2_LOCK_FREE            0
+#define P2_LOCK_HELD            1   // held by the process in the upper bits
+#define P2_LOCK_WAITERS         2   // held, release through the kernel
+#define P2_LOCK_WORD(pid)       (((pid) << 2) | P2_LOCK_HELD)   // held by pid, no waiters
+#define P2_LOCK_HOLDER(word)    ((word) >> 2)   // pid of the process holding a held lock
+
+extern volatile int P2_LockWords[];
+extern volatile int P2_LockFastAcquires[];  // # of acquires of each lock without a system call
+
+/*
+ * Events returned by Sys_WaitEvents.
+ */
+
+#define P2_EVENT_COND           1   // the condition variable was signaled
+#define P2_EVENT_TIMER          2   // the timeout expired
+#define P2_EVENT_CHILD          3   // a child terminated
+
+/*
+ * Contention statistics of a lock or condition variable, returned by Sys_LockStats and
+ * Sys_CondStats. Times are in microseconds. The hold time of a lock acquired without a system
+ * call isn't measured. For a condition variable, acquires counts waits, contended counts signals
+ * and broadcasts that released a waiter, a wait lasts from Sys_CondWait until the process is
+ * signaled, and a hold from then until the process has the lock again.
+ */
+
+typedef struct P2_LockStats {
+    char    name[P1_MAXNAME+1];
+    int     acquires;       // # of times acquired
+    int     contended;      // # of acquires that had to wait
+    int     totalWait;      // total time spent waiting to acquire
+    int     maxWait;        // max. of the above for one acquire
+    int     totalHold;      // total time held
+    int     maxHold;        // max. of the above for one acquire
+    int     maxHolder;      // pid of the process that held it for maxHold, -1 if none
+} P2_LockStats;
+
+/*
+ * Sys_GetAllProcInfo
+ *
+ * Copies the information of up to max processes into infos in one system call and returns the
+ * number of processes in *count, which may be more than max. Only processes in the given state,
+ * and with the given parent, are included; pass -1 to include all of them.
+ */
+static inline int
+Sys_GetAllProcInfo(P2_ProcInfo *infos, int max, int state, int parent, int *count)
+{
+    USLOSS_Sysargs sa;
+
+    CHECKMODE2;
+    sa.number = SYS_GETALLPROCINFO;
+    sa.arg1 = infos;
+    sa.arg2 = (void *) max;
+    sa.arg3 = (void *) state;
+    sa.arg4 = (void *) parent;
+    USLOSS_Syscall((void *) &sa);
+    if ((int) sa.arg4 == P1_SUCCESS) {
+        *count = (int) sa.arg2;
+    }
+    return (int) sa.arg4;
+}
+
+/*
+ * Sys_DiskSync
+ *
+ * Waits until all sectors written to the unit in write-back mode are on the disk.
+ */
+static inline int
+Sys_DiskSync(int unit)
+{
+    USLOSS_Sysargs sa;
+
+    CHECKMODE2;
+    sa.number = SYS_DISKSYNC;
+    sa.arg1 = (void *) unit;
+    USLOSS_Syscall((void *) &sa);
+    return (int) sa.arg4;
+}
+
+/*
+ * Sys_DiskAdvise
+ *
+ * Declares how the process will access a range of sectors on the unit. advice is one of the
+ * P2_ADVISE constants above.
+ */
+static inline int
+Sys_DiskAdvise(int unit, int first, int sectors, int advice)
+{
+    USLOSS_Sysargs sa;
+
+    CHECKMODE2;
+    sa.number = SYS_DISKADVISE;
+    sa.arg1 = (void *) advice;
+    sa.arg2 = (void *) sectors;
+    sa.arg3 = (void *) first;
+    sa.arg4 = (void *) unit;
+    USLOSS_Syscall((void *) &sa);
+    return (int) sa.arg4;
+}
+
+/*
+ * Sys_DiskPRead
+ *
+ * Reads length bytes from the unit starting at byte offset into the buffer. Neither needs to
+ * be sector-aligned.
+ */
+static inline int
+Sys_DiskPRead(void *buffer, int offset, int length, int unit)
+{
+    USLOSS_Sysargs sa;
+
+    CHECKMODE2;
+    sa.number = SYS_DISKPREAD;
+    sa.arg1 = buffer;
+    sa.arg2 = (void *) length;
+    sa.arg3 = (void *) offset;
+    sa.arg4 = (void *) unit;
+    USLOSS_Syscall((void *) &sa);
+    return (int) sa.arg4;
+}
+
+/*
+ * Sys_DiskPWrite
+ *
+ * Writes length bytes from the buffer to the unit starting at byte offset. Neither needs to be
+ * sector-aligned.
+ */
+static inline int
+Sys_DiskPWrite(void *buffer, int offset, int length, int unit)
+{
+    USLOSS_Sysargs sa;
+
+    CHECKMODE2;
+    sa.number = SYS_DISKPWRITE;
+    sa.arg1 = buffer;
+    sa.arg2 = (void *) length;
+    sa.arg3 = (void *) offset;
+    sa.arg4 = (void *) unit;
+    USLOSS_Syscall((void *) &sa);
+    return (int) sa.arg4;
+}
+
+/*
+ * Sys_LockAcquireFast
+ *
+ * Acquires the lock like Sys_LockAcquire, but without a system call if the lock is free. pid
+ * is the caller's pid from Sys_GetPid, which is recorded in the lock word so the kernel knows
+ * who holds the lock; getting it once saves a system call per acquire. Locks acquired with
+ * either function can be released with either Sys_LockRelease or Sys_LockReleaseFast.
+ */
+static inline int
+Sys_LockAcquireFast(int lid, int pid)
+{
+    USLOSS_Sysargs sa;
+    int state = P2_LOCK_FREE;
+
+    CHECKMODE2;
+    if ((lid >= 0) && (lid < P1_MAXLOCKS) && (pid >= 0) && (pid < P1_MAXPROC) &&
+        __atomic_compare_exchange_n(&P2_LockWords[lid], &state, P2_LOCK_WORD(pid), FALSE,
+                                    __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        __atomic_fetch_add(&P2_LockFastAcquires[lid], 1, __ATOMIC_RELAXED);
+        return P1_SUCCESS;
+    }
+    sa.number = SYS_LOCKACQUIRE;
+    sa.arg1 = (void *) lid;
+    USLOSS_Syscall((void *) &sa);
+    return (int) sa.arg4;
+}
+
+/*
+ * Sys_LockReleaseFast
+ *
+ * Releases the lock like Sys_LockRelease, but without a system call if the caller holds it and
+ * no processes are waiting for it. pid is the caller's pid as for Sys_LockAcquireFast.
+ */
+static inline int
+Sys_LockReleaseFast(int lid, int pid)
+{
+    USLOSS_Sysargs sa;
+    int state = P2_LOCK_WORD(pid);
+
+    CHECKMODE2;
+    if ((lid >= 0) && (lid < P1_MAXLOCKS) && (pid >= 0) && (pid < P1_MAXPROC) &&
+        __atomic_compare_exchange_n(&P2_LockWords[lid], &state, P2_LOCK_FREE, FALSE,
+                                    __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        return P1_SUCCESS;
+    }
+    sa.number = SYS_LOCKRELEASE;
+    sa.arg1 = (void *) lid;
+    USLOSS_Syscall((void *) &sa);
+    return (int) sa.arg4;
+}
+
+/*
+ * Sys_CondBroadcast
+ *
+ * Signals all processes waiting on the condition variable. They get its lock one at a time
+ * after the caller releases it.
+ */
+static inline int
+Sys_CondBroadcast(int vid)
+{
+    USLOSS_Sysargs sa;
+
+    CHECKMODE2;
+    sa.number = SYS_CONDBROADCAST;
+    sa.arg1 = (void *) vid;
+    USLOSS_Syscall((void *) &sa);
+    return (int) sa.arg4;
+}
+
+/*
+ * Sys_LockStats
+ *
+ * Returns the contention statistics of the lock.
+ */
+static inline int
+Sys_LockStats(int lid, P2_LockStats *stats)
+{
+    USLOSS_Sysargs sa;
+
+    CHECKMODE2;
+    sa.number = SYS_LOCKSTATS;
+    sa.arg1 = (void *) lid;
+    sa.arg2 = stats;
+    sa.arg3 = (void *) FALSE;
+    USLOSS_Syscall((void *) &sa);
+    return (int) sa.arg4;
+}
+
+/*
+ * Sys_CondStats
+ *
+ * Returns the contention statistics of the condition variable.
+ */
+static inline int
+Sys_CondStats(int vid, P2_LockStats *stats)
+{
+    USLOSS_Sysargs sa;
+
+    CHECKMODE2;
+    sa.number = SYS_LOCKSTATS;
+    sa.arg1 = (void *) vid;
+    sa.arg2 = stats;
+    sa.arg3 = (void *) TRUE;
+    USLOSS_Syscall((void *) &sa);
+    return (int) sa.arg4;
+}
+
+/*
+ * Sys_LockLookup
+ *
+ * Returns the id of the lock with the name in *lid.
+ */
+static inline int
+Sys_LockLookup(char *name, int *lid)
+{
+    USLOSS_Sysargs sa;
+
+    CHECKMODE2;
+    sa.number = SYS_LOCKLOOKUP;
+    sa.arg1 = name;
+    sa.arg2 = (void *) FALSE;
+    USLOSS_Syscall((void *) &sa);
+    if ((int) sa.arg4 == P1_SUCCESS) {
+        *lid = (int) sa.arg1;
+    }
+    return (int) sa.arg4;
+}
+
+/*
+ * Sys_CondLookup
+ *
+ * Returns the id of the condition variable with the name in *vid.
+ */
+static inline int
+Sys_CondLookup(char *name, int *vid)
+{
+    USLOSS_Sysargs sa;
+
+    CHECKMODE2;
+    sa.number = SYS_LOCKLOOKUP;
+    sa.arg1 = name;
+    sa.arg2 = (void *) TRUE;
+    USLOSS_Syscall((void *) &sa);
+    if ((int) sa.arg4 == P1_SUCCESS) {
+        *vid = (int) sa.arg1;
+    }
+    return (int) sa.arg4;
+}
+
+/*
+ * Sys_WaitEvents
+ *
+ * Waits until the first of several events and returns which one in *event: P2_EVENT_COND if
+ * the condition variable vid was signaled, P2_EVENT_TIMER if timeout microseconds passed, or
+ * P2_EVENT_CHILD if a child terminated and can be collected with Sys_Wait. Pass -1 for vid or
+ * timeout and FALSE for children to leave that event out. If vid is given the caller must hold
+ * its lock, which is released while waiting and held again on return, as with Sys_CondWait.
+ */
+static inline int
+Sys_WaitEvents(int vid, int timeout, int children, int *event)
+{
+    USLOSS_Sysargs sa;
+
+    CHECKMODE2;
+    sa.number = SYS_WAITEVENTS;
+    sa.arg1 = (void *) vid;
+    sa.arg2 = (void *) timeout;
+    sa.arg3 = (void *) children;
+    USLOSS_Syscall((void *) &sa);
+    if ((int) sa.arg4 == P1_SUCCESS) {
+        *event = (int) sa.arg1;
+    }
+    return (int) sa.arg4;
+}
+
+/*
+ * Sys_RwLockCreate
+ *
+ * Creates a reader-writer lock and returns its id in *id.
+ */
+static inline int
+Sys_RwLockCreate(char *name, int *id)
+{
+    USLOSS_Sysargs sa;
+
+    CHECKMODE2;
+    sa.number = SYS_RWLOCKCREATE;
+    sa.arg1 = name;
+    USLOSS_Syscall((void *) &sa);
+    if ((int) sa.arg4 == P1_SUCCESS) {
+        *id = (int) sa.arg1;
+    }
+    return (int) sa.arg4;
+}
+
+/*
+ * Sys_RwLockFree
+ *
+ * Frees a reader-writer lock. It must not be held.
+ */
+static inline int
+Sys_RwLockFree(int id)
+{
+    USLOSS_Sysargs sa;
+
+    CHECKMODE2;
+    sa.number = SYS_RWLOCKFREE;
+    sa.arg1 = (void *) id;
+    USLOSS_Syscall((void *) &sa);
+    return (int) sa.arg4;
+}
+
+/*
+ * Sys_RwLockRead
+ *
+ * Acquires a reader-writer lock for reading, shared with other readers.
+ */
+static inline int
+Sys_RwLockRead(int id)
+{
+    USLOSS_Sysargs sa;
+
+    CHECKMODE2;
+    sa.number = SYS_RWLOCKACQUIRE;
+    sa.arg1 = (void *) id;
+    sa.arg2 = (void *) FALSE;
+    USLOSS_Syscall((void *) &sa);
+    return (int) sa.arg4;
+}
+
+/*
+ * Sys_RwLockWrite
+ *
+ * Acquires a reader-writer lock for writing, excluding all other processes.
+ */
+static inline int
+Sys_RwLockWrite(int id)
+{
+    USLOSS_Sysargs sa;
+
+    CHECKMODE2;
+    sa.number = SYS_RWLOCKACQUIRE;
+    sa.arg1 = (void *) id;
+    sa.arg2 = (void *) TRUE;
+    USLOSS_Syscall((void *) &sa);
+    return (int) sa.arg4;
+}
+
+/*
+ * Sys_RwLockRelease
+ *
+ * Releases a reader-writer lock acquired with Sys_RwLockRead or Sys_RwLockWrite.
+ */
+static inline int
+Sys_RwLockRelease(int id)
+{
+    USLOSS_Sysargs sa;
+
+    CHECKMODE2;
+    sa.number = SYS_RWLOCKRELEASE;
+    sa.arg1 = (void *) id;
+    USLOSS_Syscall((void *) &sa);
+    return (int) sa.arg4;
+}
+
+/*
+ * Sys_SemCreate
+ *
+ * Creates a counting semaphore with the specified # of units and returns its id in *id.
+ */
+static inline int
+Sys_SemCreate(char *name, int value, int *id)
+{
+    USLOSS_Sysargs sa;
+
+    CHECKMODE2;
+    sa.number = SYS_SEMCREATE;
+    sa.arg1 = name;
+    sa.arg2 = (void *) value;
+    USLOSS_Syscall((void *) &sa);
+    if ((int) sa.arg4 == P1_SUCCESS) {
+        *id = (int) sa.arg1;
+    }
+    return (int) sa.arg4;
+}
+
+/*
+ * Sys_SemFree
+ *
+ * Frees a semaphore. No processes may be waiting on it.
+ */
+static inline int
+Sys_SemFree(int id)
+{
+    USLOSS_Sysargs sa;
+
+    CHECKMODE2;
+    sa.number = SYS_SEMFREE;
+    sa.arg1 = (void *) id;
+    USLOSS_Syscall((void *) &sa);
+    return (int) sa.arg4;
+}
+
+/*
+ * Sys_SemP
+ *
+ * Takes count units from the semaphore, waiting until they are available.
+ */
+static inline int
+Sys_SemP(int id, int count)
+{
+    USLOSS_Sysargs sa;
+
+    CHECKMODE2;
+    sa.number = SYS_SEMP;
+    sa.arg1 = (void *) id;
+    sa.arg2 = (void *) count;
+    sa.arg3 = (void *) FALSE;
+    USLOSS_Syscall((void *) &sa);
+    return (int) sa.arg4;
+}
+
+/*
+ * Sys_SemTryP
+ *
+ * Takes count units from the semaphore if they are available, else returns P2_WOULD_BLOCK.
+ */
+static inline int
+Sys_SemTryP(int id, int count)
+{
+    USLOSS_Sysargs sa;
+
+    CHECKMODE2;
+    sa.number = SYS_SEMP;
+    sa.arg1 = (void *) id;
+    sa.arg2 = (void *) count;
+    sa.arg3 = (void *) TRUE;
+    USLOSS_Syscall((void *) &sa);
+    return (int) sa.arg4;
+}
+
+/*
+ * Sys_SemV
+ *
+ * Returns count units to the semaphore, waking up the waiters they satisfy.
+ */
+static inline int
+Sys_SemV(int id, int count)
+{
+    USLOSS_Sysargs sa;
+
+    CHECKMODE2;
+    sa.number = SYS_SEMV;
+    sa.arg1 = (void *) id;
+    sa.arg2 = (void *) count;
+    USLOSS_Syscall((void *) &sa);
+    return (int) sa.arg4;
+}
+
+/*
+ * Sys_BarrierCreate
+ *
+ * Creates a barrier for a group of count processes and returns its id in *id.
+ */
+static inline int
+Sys_BarrierCreate(char *name, int count, int *id)
+{
+    USLOSS_Sysargs sa;
+
+    CHECKMODE2;
+    sa.number = SYS_BARRIERCREATE;
+    sa.arg1 = name;
+    sa.arg2 = (void *) count;
+    USLOSS_Syscall((void *) &sa);
+    if ((int) sa.arg4 == P1_SUCCESS) {
+        *id = (int) sa.arg1;
+    }
+    return (int) sa.arg4;
+}
+
+/*
+ * Sys_BarrierFree
+ *
+ * Frees a barrier. No processes may be waiting at it.
+ */
+static inline int
+Sys_BarrierFree(int id)
+{
+    USLOSS_Sysargs sa;
+
+    CHECKMODE2;
+    sa.number = SYS_BARRIERFREE;
+    sa.arg1 = (void *) id;
+    USLOSS_Syscall((void *) &sa);
+    return (int) sa.arg4;
+}
+
+/*
+ * Sys_BarrierWait
+ *
+ * Waits until every process in the barrier's group has called Sys_BarrierWait.
+ */
+static inline int
+Sys_BarrierWait(int id)
+{
+    USLOSS_Sysargs sa;
+
+    CHECKMODE2;
+    sa.number = SYS_BARRIERWAIT;
+    sa.arg1 = (void *) id;
+    USLOSS_Syscall((void *) &sa);
+    return (int) sa.arg4;
+}
+
+/*
+ * Sys_MailboxCreate
+ *
+ * Creates a mailbox that holds up to slots messages of up to size bytes and returns its id in
+ * *id. The size must be positive. A mailbox with no slots passes each message directly from a
+ * sender to a receiver.
+ */
+static inline int
+Sys_MailboxCreate(char *name, int slots, int size, int *id)
+{
+    USLOSS_Sysargs sa;
+
+    CHECKMODE2;
+    sa.number = SYS_MAILBOXCREATE;
+    sa.arg1 = name;
+    sa.arg2 = (void *) slots;
+    sa.arg3 = (void *) size;
+    USLOSS_Syscall((void *) &sa);
+    if ((int) sa.arg4 == P1_SUCCESS) {
+        *id = (int) sa.arg1;
+    }
+    return (int) sa.arg4;
+}
+
+/*
+ * Sys_MailboxFree
+ *
+ * Frees a mailbox and any messages in it. No processes may be waiting on it.
+ */
+static inline int
+Sys_MailboxFree(int id)
+{
+    USLOSS_Sysargs sa;
+
+    CHECKMODE2;
+    sa.number = SYS_MAILBOXFREE;
+    sa.arg1 = (void *) id;
+    USLOSS_Syscall((void *) &sa);
+    return (int) sa.arg4;
+}
+
+/*
+ * Sys_MailboxSend
+ *
+ * Sends a message of size bytes, waiting until there is room in the mailbox or a receiver.
+ */
+static inline int
+Sys_MailboxSend(int id, void *msg, int size)
+{
+    USLOSS_Sysargs sa;
+
+    CHECKMODE2;
+    sa.number = SYS_MAILBOXSEND;
+    sa.arg1 = (void *) id;
+    sa.arg2 = msg;
+    sa.arg3 = (void *) size;
+    sa.arg4 = (void *) FALSE;
+    USLOSS_Syscall((void *) &sa);
+    return (int) sa.arg4;
+}
+
+/*
+ * Sys_MailboxCondSend
+ *
+ * Sends a message if it can be done without waiting, else returns P2_WOULD_BLOCK.
+ */
+static inline int
+Sys_MailboxCondSend(int id, void *msg, int size)
+{
+    USLOSS_Sysargs sa;
+
+    CHECKMODE2;
+    sa.number = SYS_MAILBOXSEND;
+    sa.arg1 = (void *) id;
+    sa.arg2 = msg;
+    sa.arg3 = (void *) size;
+    sa.arg4 = (void *) TRUE;
+    USLOSS_Syscall((void *) &sa);
+    return (int) sa.arg4;
+}
+
+/*
+ * Sys_MailboxReceive
+ *
+ * Receives a message into the buffer, waiting until there is one. On entry *size is the size of
+ * the buffer and on return the size of the message. A message larger than the buffer is left to
+ * be received and P2_BUFFER_TOO_SMALL is returned with its size in *size.
+ */
+static inline int
+Sys_MailboxReceive(int id, void *buffer, int *size)
+{
+    USLOSS_Sysargs sa;
+
+    CHECKMODE2;
+    sa.number = SYS_MAILBOXRECEIVE;
+    sa.arg1 = (void *) id;
+    sa.arg2 = buffer;
+    sa.arg3 = (void *) *size;
+    sa.arg4 = (void *) FALSE;
+    USLOSS_Syscall((void *) &sa);
+    if (((int) sa.arg4 == P1_SUCCESS) || ((int) sa.arg4 == P2_BUFFER_TOO_SMALL)) {
+        *size = (int) sa.arg3;
+    }
+    return (int) sa.arg4;
+}
+
+/*
+ * Sys_MailboxCondReceive
+ *
+ * Receives a message if there is one, else returns P2_WOULD_BLOCK.
+ */
+static inline int
+Sys_MailboxCondReceive(int id, void *buffer, int *size)
+{
+    USLOSS_Sysargs sa;
+
+    CHECKMODE2;
+    sa.number = SYS_MAILBOXRECEIVE;
+    sa.arg1 = (void *) id;
+    sa.arg2 = buffer;
+    sa.arg3 = (void *) *size;
+    sa.arg4 = (void *) TRUE;
+    USLOSS_Syscall((void *) &sa);
+    if (((int) sa.arg4 == P1_SUCCESS) || ((int) sa.arg4 == P2_BUFFER_TOO_SMALL)) {
+        *size = (int) sa.arg3;
+    }
+    return (int) sa.arg4;
+}
+
+#endif
@@ -3,9 +3,19 @@
  *
  * These are stub implementations of P3_AllocatePageTable and P3_FreePageTable
  * for use in phases 1 and 2 of the project.
+ *
+ * Until P3_VmInit is called there is no VM and P3_AllocatePageTable returns NULL.
+ * P3_VmInit allocates a slab with a page table for each of the P1_MAXPROC
+ * processes in one call; the slab comes from calloc so the OS zero-fills its
+ * pages on first touch. Free tables are kept on a list, so finding a table and
+ * freeing one are O(1). A table that has never been used is already zero, so
+ * allocating it is O(1) as well. A recycled table is cleared when it is reused,
+ * which is O(pages): the MMU reads the entries directly, so they can't be left
+ * stale for the VM layer to check later. The VM layer fills entries on demand.
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "phase1.h"
 #include "assert.h"
@@ -19,41 +29,108 @@
 static int allocated[P1_MAXPROC];
 static int initialized = 0;
 
+static USLOSS_PTE *slab = NULL;     // page tables, NULL if there is no VM
+static int numPages;                // # of entries in a page table
+static int tableOf[P1_MAXPROC];     // index of each process's table, -1 if none
+static int nextFree[P1_MAXPROC];    // next table on the free list
+static int dirty[P1_MAXPROC];       // table was used and must be cleared
+static int freeList = -1;           // first free table, -1 if none
+
 int p3mode = 1;
 int p3aborts = 0;
 
-USLOSS_PTE *
-P3_AllocatePageTable(int pid)
+static void
+Initialize(void)
 {
     if (! initialized) {
         memset(allocated, 0, sizeof(allocated));
+        memset(tableOf, -1, sizeof(tableOf));
         initialized = 1;
     }
+}
+
+USLOSS_PTE *
+P3_AllocatePageTable(int pid)
+{
+    int i;
+
+    Initialize();
     myassert((pid >= 0) && (pid < P1_MAXPROC));
+    if ((pid < 0) || (pid >= P1_MAXPROC)) {
+        return NULL;
+    }
     myassert(allocated[pid] == 0);
+    if (allocated[pid]) {
+        return (tableOf[pid] < 0) ? NULL : &slab[tableOf[pid] * numPages];
+    }
     allocated[pid] = 1;
-    return NULL;
+    if (slab == NULL) {
+        return NULL;
+    }
+    i = freeList;
+    assert(i >= 0);
+    freeList = nextFree[i];
+    if (dirty[i]) {
+        memset(&slab[i * numPages], 0, numPages * sizeof(USLOSS_PTE));
+        dirty[i] = 0;
+    }
+    tableOf[pid] = i;
+    return &slab[i * numPages];
 }
 
 void
 P3_FreePageTable(int pid)
 {
+    int i;
+
     myassert(initialized);
     myassert((pid >= 0) && (pid < P1_MAXPROC));
+    if (!initialized || (pid < 0) || (pid >= P1_MAXPROC)) {
+        return;
+    }
     myassert(allocated[pid] == 1);
     allocated[pid] = 0;
+    i = tableOf[pid];
+    if (i >= 0) {
+        dirty[i] = 1;
+        nextFree[i] = freeList;
+        freeList = i;
+        tableOf[pid] = -1;
+    }
 }
 
 int
 P3_VmInit(int mappings, int pages, int frames, int pagers2)
 {
+    Initialize();
+    if ((slab != NULL) || (pages <= 0)) {
+        return 0;
+    }
+    slab = calloc(P1_MAXPROC * pages, sizeof(USLOSS_PTE));
+    assert(slab != NULL);
+    numPages = pages;
+    for (int i = P1_MAXPROC - 1; i >= 0; i--) {
+        dirty[i] = 0;
+        nextFree[i] = freeList;
+        freeList = i;
+    }
     return 0;
 }
 
 void
 P3_VmShutdown(void)
 {
+    int outstanding = 0;
+
+    // the tables are freed with the slab, so no process may still hold one
+    for (int pid = 0; pid < P1_MAXPROC; pid++) {
+        outstanding += allocated[pid];
+    }
+    myassert(outstanding == 0);
+    memset(allocated, 0, sizeof(allocated));
+    free(slab);
+    slab = NULL;
+    freeList = -1;
+    memset(tableOf, -1, sizeof(tableOf));
     return;
 }
-
-
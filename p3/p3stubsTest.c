@@ -84,6 +84,51 @@ int main(int argc, char **argv)
     CheckAborts(1);
     count++;
 
+    // Page tables come from the slab once there is VM.
+
+    current = p3aborts;
+    P3_VmInit(0, 16, 8, 1);
+    table = P3_AllocatePageTable(3);
+    assert(table != NULL);
+    for (int i = 0; i < 16; i++) {
+        assert(table[i].incore == 0);
+        table[i].incore = 1;
+        table[i].frame = i;
+    }
+    P3_FreePageTable(3);
+    CheckAborts(0);
+    count++;
+
+    // A freed table is recycled and cleared.
+
+    current = p3aborts;
+    USLOSS_PTE *other = P3_AllocatePageTable(4);
+    assert(other == table);
+    for (int i = 0; i < 16; i++) {
+        assert((other[i].incore == 0) && (other[i].frame == 0));
+    }
+    table = P3_AllocatePageTable(5);
+    assert((table != NULL) && (table != other));
+    P3_FreePageTable(4);
+    P3_FreePageTable(5);
+    CheckAborts(0);
+    count++;
+
+    // Shutting down the VM with a table outstanding.
+
+    current = p3aborts;
+    table = P3_AllocatePageTable(6);
+    P3_VmShutdown();
+    CheckAborts(1);
+    count++;
+
+    current = p3aborts;
+    table = P3_AllocatePageTable(6);
+    assert(table == NULL);
+    P3_FreePageTable(6);
+    CheckAborts(0);
+    count++;
+
     printf("All tests passed.\n");
 }
 
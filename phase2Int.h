@@ -8,19 +8,98 @@
 #define _PHASE2_INT_H
 
 #include "phase2.h"
+#include "libuser2.h"
 
 // Phase 2a
 
+#define TAG_KERNEL 0
+#define TAG_USER 1
+
 void    P2ProcInit(void);
+int     P2ProcRegisterExit(void (*handler)(int pid));
+int     P2ProcSyscall(int pid);
+int     P2_GetAllProcInfo(P2_ProcInfo *infos, int max, int state, int parent,
+                          int *count) CHECKRETURN;
 
 // Phase 2b
 
 void    P2ClockInit(void);
 void    P2ClockShutdown(void);
+int     P2ClockRegister(void (*handler)(int now));
+
+/*
+ * Profile buckets for P2ClockProfile other than system call numbers.
+ */
+#define P2_PROFILE_USER     -1  // user code
+#define P2_PROFILE_KERNEL   -2  // kernel code outside a system call, e.g. a driver
+
+int     P2ClockProfile(char *name, int bucket, int *time);
+void    P2ClockDumpProfile(void);
 
 // Phase 2c
 
+typedef struct P2DiskStats {
+    int     poolSize;       // # of request descriptors
+    int     poolHighWater;  // max. # of request descriptors in use at once
+    int     dirtyBytes;     // bytes written in write-back mode but not yet on the disk
+    int     maxDirtyBytes;  // max. of dirtyBytes
+    int     flushes;        // # of write-back flushes
+    int     flushedBytes;   // total bytes written by flushes
+    int     flushLatency;   // duration of the last flush in microseconds
+    int     maxFlushLatency;// max. of flushLatency
+    int     cancelled;      // # of queued requests dropped by P2DiskCancel
+    int     aborted;        // # of requests in progress stopped by P2DiskCancel or because
+                            // their process died
+    int     cacheHits;      // # of reads served entirely from the cache
+    int     cacheMisses;    // # of reads that went to the disk
+    int     readahead;      // # of sectors read ahead into the cache
+    int     cached;         // # of clean sectors in the cache
+    int     startLatency;   // time from the first request to the driver being ready in us
+    int     drainLatency;   // time from P2DiskShutdown to the driver exiting in us
+    int     abandoned;      // # of requests failed because the drain limit passed
+    int     policy;         // scheduling policy in effect, P2_DISK_SSTF, ELEVATOR, or FIFO
+    int     policySwitches; // # of times the adaptive scheduler switched policies
+    int     paging;         // # of paging requests
+    int     seeks;          // # of seek operations issued to the disk
+    int     seekTracks;     // total # of tracks the disk head moved in those seeks
+} P2DiskStats;
+
+/*
+ * Disk scheduling policies for P2DiskSetPolicy. Requests whose deadline has passed are served
+ * first regardless of the policy.
+ */
+#define P2_DISK_SSTF        0   // shortest seek first, the default
+#define P2_DISK_ELEVATOR    1   // sweep across the disk in one direction, then the other
+#define P2_DISK_FIFO        2   // arrival order
+#define P2_DISK_ADAPTIVE    3   // one of the above, chosen from the recent workload
+
+int     P2_DiskSync(int unit) CHECKRETURN;
+int     P2_DiskAdvise(int unit, int first, int sectors, int advice) CHECKRETURN;
+int     P2_DiskPRead(int unit, int offset, int length, void *buffer) CHECKRETURN;
+int     P2_DiskPWrite(int unit, int offset, int length, void *buffer) CHECKRETURN;
+
 void    P2DiskInit(void);
 void    P2DiskShutdown(void);
+int     P2DiskGetStats(int unit, P2DiskStats *stats);
+int     P2DiskSetWriteBack(int unit, int enable);
+int     P2DiskSetFair(int unit, int enable);
+int     P2DiskSetPolicy(int unit, int policy);
+int     P2DiskSetShare(int pid, int weight, int sectorsPerSecond);
+void    P2DiskCancel(int pid);
+int     P2DiskInherit(int pid, int priority);
+int     P2DiskPageIn(int unit, int first, int sectors, void *buffer);
+int     P2DiskPageOut(int unit, int first, int sectors, void *buffer);
+
+void    P2SwapSetup(void);
+int     P2SwapInit(int unit, int firstTrack, int tracks, int pageSize);
+int     P2SwapAlloc(int pages, int *slot);
+int     P2SwapFree(int slot, int pages);
+int     P2SwapRead(int slot, int pages, void *buffer);
+int     P2SwapWrite(int slot, int pages, void *buffer);
+int     P2SwapSector(int slot, int *unit, int *sector);
+
+// Phase 2d
+
+int     P2LockStats(int id, int cond, P2_LockStats *stats);
 
 #endif
\ No newline at end of file
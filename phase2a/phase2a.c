@@ -9,10 +9,17 @@
 
 #include "phase2Int.h"
 
-#define TAG_KERNEL 0
-#define TAG_USER 1
-
 static void SpawnStub(USLOSS_Sysargs *sysargs);
+static void GetAllProcInfoStub(USLOSS_Sysargs *sysargs);
+
+#define MAX_EXIT_HANDLERS 8
+
+static void (*exitHandlers[MAX_EXIT_HANDLERS])(int pid); // called when a process terminates
+static int numExitHandlers = 0;
+
+static int syscalls[P1_MAXPROC];    // system call each process is in, -1 if none
+
+static void (*syscallHandlers[USLOSS_MAX_SYSCALLS])(USLOSS_Sysargs *args);
 
 /*
  * IllegalHandler
@@ -38,8 +45,18 @@ static void
 SyscallHandler(int type, void *arg) 
 {
     USLOSS_Sysargs *sysargs = (USLOSS_Sysargs *) arg;
+    int pid = P1_GetPid();
+
     // call the proper handler for the system call.
-    sysargs->arg4 = (void *) P2_INVALID_SYSCALL;
+    if ((sysargs->number < 0) || (sysargs->number >= USLOSS_MAX_SYSCALLS) ||
+        (syscallHandlers[sysargs->number] == NULL)) {
+        sysargs->arg4 = (void *) P2_INVALID_SYSCALL;
+        return;
+    }
+    // the clock profiler charges the time until the handler returns to this system call
+    syscalls[pid] = sysargs->number;
+    syscallHandlers[sysargs->number](sysargs);
+    syscalls[pid] = -1;
 }
 
 
@@ -55,12 +72,17 @@ P2ProcInit(void)
 {
     int rc;
 
+    for (int i = 0; i < P1_MAXPROC; i++) {
+        syscalls[i] = -1;
+    }
     USLOSS_IntVec[USLOSS_ILLEGAL_INT] = IllegalHandler;
     USLOSS_IntVec[USLOSS_SYSCALL_INT] = SyscallHandler;
 
     // call P2_SetSyscallHandler to set handlers for all system calls
     rc = P2_SetSyscallHandler(SYS_SPAWN, SpawnStub);
     assert(rc == P1_SUCCESS);
+    rc = P2_SetSyscallHandler(SYS_GETALLPROCINFO, GetAllProcInfoStub);
+    assert(rc == P1_SUCCESS);
 }
 
 /*
@@ -73,9 +95,45 @@ P2ProcInit(void)
 int
 P2_SetSyscallHandler(unsigned int number, void (*handler)(USLOSS_Sysargs *args))
 {
+    if (number >= USLOSS_MAX_SYSCALLS) {
+        return P2_INVALID_SYSCALL;
+    }
+    syscallHandlers[number] = handler;
     return P1_SUCCESS;
 }
 
+/*
+ * P2ProcRegisterExit
+ *
+ * Registers a function that is called with the pid of every user-level process that 
+ * terminates, before it quits. Other parts of the kernel use this to release resources that
+ * belong to the process.
+ */
+int
+P2ProcRegisterExit(void (*handler)(int pid))
+{
+    if (handler == NULL) {
+        return P2_NULL_ADDRESS;
+    }
+    assert(numExitHandlers < MAX_EXIT_HANDLERS);
+    exitHandlers[numExitHandlers++] = handler;
+    return P1_SUCCESS;
+}
+
+/*
+ * P2ProcSyscall
+ *
+ * Returns the number of the system call the process is in, -1 if it isn't in one.
+ */
+int
+P2ProcSyscall(int pid)
+{
+    if ((pid < 0) || (pid >= P1_MAXPROC)) {
+        return -1;
+    }
+    return syscalls[pid];
+}
+
 /*
  * P2_Spawn
  *
@@ -114,10 +172,62 @@ int
 P2_Terminate(int status) 
 {
     // do something here
+    for (int i = 0; i < numExitHandlers; i++) {
+        exitHandlers[i](P1_GetPid());
+    }
     return P1_SUCCESS;
 
 }
 
+/*
+ * P2_GetAllProcInfo
+ *
+ * Copies the information of up to max processes into infos and returns the number of processes
+ * in *count, which may be more than max. Only processes in the given state, and with the given
+ * parent, are included; -1 includes all of them. Interrupts are disabled while the process table
+ * is read so that the snapshot is consistent.
+ */
+int
+P2_GetAllProcInfo(P2_ProcInfo *infos, int max, int state, int parent, int *count)
+{
+    P1_ProcInfo info;
+    int         psr;
+    int         rc;
+
+    if (max < 0) {
+        return P2_INVALID_ARGUMENT;
+    }
+    if (((infos == NULL) && (max > 0)) || (count == NULL)) {
+        return P2_NULL_ADDRESS;
+    }
+    if ((state != -1) && ((state <= P1_STATE_FREE) || (state > P1_STATE_JOINING))) {
+        return P1_INVALID_STATE;
+    }
+    if ((parent < -1) || (parent >= P1_MAXPROC)) {
+        return P1_INVALID_PID;
+    }
+    psr = USLOSS_PsrGet();
+    rc = USLOSS_PsrSet(psr & ~USLOSS_PSR_CURRENT_INT);
+    assert(rc == USLOSS_DEV_OK);
+    *count = 0;
+    for (int pid = 0; pid < P1_MAXPROC; pid++) {
+        rc = P1_GetProcInfo(pid, &info);
+        if ((rc != P1_SUCCESS) || (info.state == P1_STATE_FREE) ||
+            ((state != -1) && (info.state != state)) ||
+            ((parent != -1) && (info.parent != parent))) {
+            continue;
+        }
+        if (*count < max) {
+            infos[*count].pid = pid;
+            infos[*count].info = info;
+        }
+        (*count)++;
+    }
+    rc = USLOSS_PsrSet(psr);
+    assert(rc == USLOSS_DEV_OK);
+    return P1_SUCCESS;
+}
+
 /*
  * SpawnStub
  *
@@ -140,3 +250,22 @@ SpawnStub(USLOSS_Sysargs *sysargs)
     }
     sysargs->arg4 = (void *) rc;
 }
+
+/*
+ * GetAllProcInfoStub
+ *
+ * Stub for Sys_GetAllProcInfo system call.
+ *
+ */
+
+static void
+GetAllProcInfoStub(USLOSS_Sysargs *sysargs)
+{
+    int count;
+    int rc = P2_GetAllProcInfo((P2_ProcInfo *) sysargs->arg1, (int) sysargs->arg2,
+                               (int) sysargs->arg3, (int) sysargs->arg4, &count);
+    if (rc == P1_SUCCESS) {
+        sysargs->arg2 = (void *) count;
+    }
+    sysargs->arg4 = (void *) rc;
+}
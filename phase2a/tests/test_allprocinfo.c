@@ -0,0 +1,115 @@
+/*
+ * test_allprocinfo.c
+ *
+ * Tests Sys_GetAllProcInfo. Compares the snapshot with Sys_GetProcInfo for every process, and
+ * checks the state and parent filters and a buffer that is too small.
+ *
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <assert.h>
+#include <libuser.h>
+
+#include "tester.h"
+#include "libuser2.h"
+#include "phase2Int.h"
+
+#define CHILDREN 3
+
+static P2_ProcInfo infos[P1_MAXPROC];
+
+int P2_Startup(void *arg)
+{
+    int rc, pid, status;
+
+    P2ProcInit();
+    rc = P2_Spawn("P3_Startup", P3_Startup, NULL, 4*USLOSS_MIN_STACK, 2, &pid);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = P2_Wait(&pid, &status);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(status, 0);
+    PASSED();
+    return 0;
+}
+
+int Child(void *arg) {
+    return 0;
+}
+
+int P3_Startup(void *arg) {
+    int rc, pid, self, count, status;
+    int children[CHILDREN];
+    int live = 0;
+    P1_ProcInfo info;
+
+    rc = Sys_GetAllProcInfo(infos, -1, -1, -1, &count);
+    TEST_RC(rc, P2_INVALID_ARGUMENT);
+    rc = Sys_GetAllProcInfo(NULL, P1_MAXPROC, -1, -1, &count);
+    TEST_RC(rc, P2_NULL_ADDRESS);
+    rc = Sys_GetAllProcInfo(infos, P1_MAXPROC, P1_STATE_FREE, -1, &count);
+    TEST_RC(rc, P1_INVALID_STATE);
+    rc = Sys_GetAllProcInfo(infos, P1_MAXPROC, -1, P1_MAXPROC, &count);
+    TEST_RC(rc, P1_INVALID_PID);
+
+    // the children have a lower priority so they are ready until this process waits
+    Sys_GetPid(&self);
+    for (int i = 0; i < CHILDREN; i++) {
+        rc = Sys_Spawn("Child", Child, NULL, USLOSS_MIN_STACK, 3, &children[i]);
+        TEST_RC(rc, P1_SUCCESS);
+    }
+
+    rc = Sys_GetAllProcInfo(infos, P1_MAXPROC, -1, -1, &count);
+    TEST_RC(rc, P1_SUCCESS);
+    for (int i = 0; i < P1_MAXPROC; i++) {
+        rc = Sys_GetProcInfo(i, &info);
+        if ((rc == P1_SUCCESS) && (info.state != P1_STATE_FREE)) {
+            TEST(infos[live].pid, i);
+            TEST(strcmp(infos[live].info.name, info.name), 0);
+            TEST(infos[live].info.parent, info.parent);
+            live++;
+        }
+    }
+    TEST(count, live);
+    DumpProcesses();
+
+    rc = Sys_GetAllProcInfo(infos, P1_MAXPROC, -1, self, &count);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(count, CHILDREN);
+    for (int i = 0; i < CHILDREN; i++) {
+        TEST(infos[i].pid, children[i]);
+        TEST(infos[i].info.state, P1_STATE_READY);
+    }
+    rc = Sys_GetAllProcInfo(infos, P1_MAXPROC, P1_STATE_RUNNING, -1, &count);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(count, 1);
+    TEST(infos[0].pid, self);
+
+    // a buffer that is too small gets the first processes and the full count
+    memset(infos, 0, sizeof(infos));
+    rc = Sys_GetAllProcInfo(infos, 1, -1, self, &count);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(count, CHILDREN);
+    TEST(infos[0].pid, children[0]);
+    TEST(infos[1].pid, 0);
+
+    for (int i = 0; i < CHILDREN; i++) {
+        rc = Sys_Wait(&pid, &status);
+        TEST_RC(rc, P1_SUCCESS);
+    }
+    rc = Sys_GetAllProcInfo(infos, P1_MAXPROC, -1, self, &count);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(count, 0);
+    return 0;
+}
+
+void test_setup(int argc, char **argv) {
+}
+
+void test_cleanup(int argc, char **argv) {
+}
+
+void finish(int argc, char **argv) {}
@@ -13,6 +13,36 @@ static int      ClockDriver(void *);
 static void     SleepStub(USLOSS_Sysargs *sysargs);
 
 static int      now; // current time
+static int      clockPid = -1;
+
+#define MAX_HANDLERS 8
+
+static void     (*handlers[MAX_HANDLERS])(int now); // called on every clock interrupt
+static int      numHandlers = 0;
+
+/*
+ * Profile of where the CPU time goes. On every clock interrupt the CPU time each process used
+ * since the previous interrupt is charged to what the process is doing at the interrupt: user
+ * code, the system call it is in, or other kernel code. Time is kept by process name so that it
+ * survives the process, and can be read with P2ClockProfile or dumped with P2ClockDumpProfile.
+ * It is dumped when the clock is shut down if the P2_PROFILE environment variable is set.
+ */
+#define MAX_PROFILES    100
+#define PROFILE_USER    USLOSS_MAX_SYSCALLS         // bucket for user code
+#define PROFILE_KERNEL  (USLOSS_MAX_SYSCALLS + 1)   // bucket for kernel code
+#define PROFILE_BUCKETS (USLOSS_MAX_SYSCALLS + 2)
+
+typedef struct Profile {
+    char    name[P1_MAXNAME+1];
+    int     time[PROFILE_BUCKETS];  // CPU time in each bucket
+} Profile;
+
+static Profile  profiles[MAX_PROFILES];
+static int      numProfiles = 0;
+static int      profileOf[P1_MAXPROC];  // profile of each process, -1 if none
+static int      lastCpu[P1_MAXPROC];    // CPU time of each process at the previous interrupt
+
+static void     ProfileTick(int now);
 
 /*
  * P2ClockInit
@@ -27,23 +57,176 @@ P2ClockInit(void)
     P2ProcInit();
 
     // initialize data structures here
+    for (int i = 0; i < P1_MAXPROC; i++) {
+        profileOf[i] = -1;
+    }
+    rc = P2ClockRegister(ProfileTick);
+    assert(rc == P1_SUCCESS);
 
     rc = P2_SetSyscallHandler(SYS_SLEEP, SleepStub);
     assert(rc == P1_SUCCESS);
 
     // fork the clock driver here
+    rc = P1_Fork("Clock Driver", ClockDriver, NULL, USLOSS_MIN_STACK * 2, 1, &clockPid);
+    assert(rc == P1_SUCCESS);
 }
 
 /*
  * P2ClockShutdown
  *
- * Clean up the clock data structures and stop the clock driver.
+ * Clean up the clock data structures and stop the clock driver. Must be called by the process
+ * that called P2ClockInit, after it has joined its other children, because the driver is its
+ * child and is joined here.
  */
 
 void 
 P2ClockShutdown(void) 
 {
+    int rc, pid, status;
+
     // stop clock driver
+    rc = P1_WakeupDevice(USLOSS_CLOCK_DEV, 0, 0, TRUE);
+    assert(rc == P1_SUCCESS);
+    rc = P1_Join(&pid, &status);
+    assert(rc == P1_SUCCESS);
+    assert(pid == clockPid);
+    clockPid = -1;
+
+    if (getenv("P2_PROFILE") != NULL) {
+        P2ClockDumpProfile();
+    }
+}
+
+/*
+ * P2ClockRegister
+ *
+ * Registers a function that the clock driver calls with the current time on every clock 
+ * interrupt. Handlers run in the clock driver so they must not block for long.
+ */
+int
+P2ClockRegister(void (*handler)(int now))
+{
+    if (handler == NULL) {
+        return P2_NULL_ADDRESS;
+    }
+    assert(numHandlers < MAX_HANDLERS);
+    handlers[numHandlers++] = handler;
+    return P1_SUCCESS;
+}
+
+/*
+ * FindProfile
+ *
+ * Returns the profile of processes with the name, creating it if necessary. Returns -1 if there
+ * isn't room for it.
+ */
+static int
+FindProfile(char *name)
+{
+    for (int i = 0; i < numProfiles; i++) {
+        if (strcmp(profiles[i].name, name) == 0) {
+            return i;
+        }
+    }
+    if (numProfiles == MAX_PROFILES) {
+        return -1;
+    }
+    snprintf(profiles[numProfiles].name, sizeof(profiles[numProfiles].name), "%s", name);
+    return numProfiles++;
+}
+
+/*
+ * ProfileTick
+ *
+ * Clock handler that charges the CPU time each process used since the previous clock interrupt
+ * to the bucket of its profile for what it is doing now.
+ */
+static void
+ProfileTick(int now)
+{
+    P1_ProcInfo info;
+    int         rc;
+    int         bucket;
+
+    for (int pid = 0; pid < P1_MAXPROC; pid++) {
+        rc = P1_GetProcInfo(pid, &info);
+        if ((rc != P1_SUCCESS) || (info.state == P1_STATE_FREE)) {
+            profileOf[pid] = -1;
+            continue;
+        }
+        if ((profileOf[pid] == -1) || (info.cpu < lastCpu[pid]) ||
+            (strcmp(profiles[profileOf[pid]].name, info.name) != 0)) {
+            // a new process with this pid
+            profileOf[pid] = FindProfile(info.name);
+            lastCpu[pid] = 0;
+            if (profileOf[pid] == -1) {
+                continue;
+            }
+        }
+        bucket = P2ProcSyscall(pid);
+        if ((bucket < 0) || (bucket >= USLOSS_MAX_SYSCALLS)) {
+            bucket = (info.tag == TAG_USER) ? PROFILE_USER : PROFILE_KERNEL;
+        }
+        profiles[profileOf[pid]].time[bucket] += info.cpu - lastCpu[pid];
+        lastCpu[pid] = info.cpu;
+    }
+}
+
+/*
+ * P2ClockProfile
+ *
+ * Returns in *time the CPU time processes with the name spent in the bucket, which is a system
+ * call number, P2_PROFILE_USER, or P2_PROFILE_KERNEL.
+ */
+int
+P2ClockProfile(char *name, int bucket, int *time)
+{
+    int i;
+
+    if ((name == NULL) || (time == NULL)) {
+        return P2_NULL_ADDRESS;
+    }
+    if (bucket == P2_PROFILE_USER) {
+        bucket = PROFILE_USER;
+    } else if (bucket == P2_PROFILE_KERNEL) {
+        bucket = PROFILE_KERNEL;
+    } else if ((bucket < 0) || (bucket >= USLOSS_MAX_SYSCALLS)) {
+        return P2_INVALID_ARGUMENT;
+    }
+    for (i = 0; i < numProfiles; i++) {
+        if (strcmp(profiles[i].name, name) == 0) {
+            break;
+        }
+    }
+    *time = (i < numProfiles) ? profiles[i].time[bucket] : 0;
+    return P1_SUCCESS;
+}
+
+/*
+ * P2ClockDumpProfile
+ *
+ * Prints the profile in folded-stack format, one line per process name and bucket with the
+ * frames separated by semicolons followed by the CPU time, e.g. "P3_Startup;kernel;syscall_13
+ * 2000". Flame graph tools read this format directly.
+ */
+void
+P2ClockDumpProfile(void)
+{
+    for (int i = 0; i < numProfiles; i++) {
+        for (int j = 0; j < PROFILE_BUCKETS; j++) {
+            if (profiles[i].time[j] == 0) {
+                continue;
+            }
+            if (j == PROFILE_USER) {
+                USLOSS_Console("%s;user %d\n", profiles[i].name, profiles[i].time[j]);
+            } else if (j == PROFILE_KERNEL) {
+                USLOSS_Console("%s;kernel %d\n", profiles[i].name, profiles[i].time[j]);
+            } else {
+                USLOSS_Console("%s;kernel;syscall_%d %d\n", profiles[i].name, j,
+                               profiles[i].time[j]);
+            }
+        }
+    }
 }
 
 /*
@@ -66,6 +249,10 @@ ClockDriver(void *arg)
         assert(rc == P1_SUCCESS);
 
         // wakeup any sleeping processes whose wakeup time has arrived
+
+        for (int i = 0; i < numHandlers; i++) {
+            handlers[i](now);
+        }
     }
     return P1_SUCCESS;
 }
@@ -0,0 +1,123 @@
+/*
+ * test_profile.c
+ *
+ * Tests the clock profiler. Spinner uses the CPU in user mode for half a second, Busy uses it
+ * for as long inside a system call, and Sleeper sleeps. Spinner's time is charged to user code,
+ * Busy's to the system call, and Sleeper's is negligible. Dumps the profile in folded-stack
+ * format.
+ *
+ */
+
+
+#include <assert.h>
+#include <usloss.h>
+#include <stdlib.h>
+#include <libuser.h>
+
+#include "tester.h"
+#include "phase2Int.h"
+
+#define SPIN 500000     // microseconds
+#define SYS_BUSY (USLOSS_MAX_SYSCALLS - 30)    // not used by the kernel
+
+static void BusyStub(USLOSS_Sysargs *sysargs) {
+    int start = USLOSS_Clock();
+
+    while (USLOSS_Clock() - start < SPIN) {
+        // spin in the kernel
+    }
+    sysargs->arg4 = (void *) P1_SUCCESS;
+}
+
+int Busy(void *arg) {
+    USLOSS_Sysargs sa;
+
+    sa.number = SYS_BUSY;
+    USLOSS_Syscall((void *) &sa);
+    TEST_RC((int) sa.arg4, P1_SUCCESS);
+    return 0;
+}
+
+int Spinner(void *arg) {
+    int start, now;
+
+    Sys_GetTimeOfDay(&start);
+    do {
+        Sys_GetTimeOfDay(&now);
+    } while (now - start < SPIN);
+    return 0;
+}
+
+int Sleeper(void *arg) {
+    int rc = Sys_Sleep(1);
+    TEST_RC(rc, P1_SUCCESS);
+    return 0;
+}
+
+int
+P3_Startup(void *arg)
+{
+    int status, rc;
+    int pid = -1;
+
+    rc = Sys_Spawn("Spinner", Spinner, NULL, USLOSS_MIN_STACK, 3, &pid);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_Spawn("Busy", Busy, NULL, USLOSS_MIN_STACK, 3, &pid);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_Spawn("Sleeper", Sleeper, NULL, USLOSS_MIN_STACK, 3, &pid);
+    TEST_RC(rc, P1_SUCCESS);
+    for (int i = 0; i < 3; i++) {
+        rc = Sys_Wait(&pid, &status);
+        TEST_RC(rc, P1_SUCCESS);
+    }
+    return 11;
+}
+
+int P2_Startup(void *arg)
+{
+    int rc, waitPid = -1, status = 0, p3Pid = -2;
+    int spinner, busy, sleeper, time;
+
+    P2ClockInit();
+    rc = P2_SetSyscallHandler(SYS_BUSY, BusyStub);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = P2_Spawn("P3_Startup", P3_Startup, NULL, 4*USLOSS_MIN_STACK, 2, &p3Pid);
+    TEST_RC(rc, P1_SUCCESS);
+
+    rc = P2_Wait(&waitPid, &status);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(status, 11);
+
+    rc = P2ClockProfile("Spinner", 0, NULL);
+    TEST_RC(rc, P2_NULL_ADDRESS);
+    rc = P2ClockProfile("Spinner", USLOSS_MAX_SYSCALLS, &time);
+    TEST_RC(rc, P2_INVALID_ARGUMENT);
+    rc = P2ClockProfile("Spinner", P2_PROFILE_USER, &spinner);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = P2ClockProfile("Sleeper", P2_PROFILE_USER, &sleeper);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(spinner > SPIN / 2, 1);
+    rc = P2ClockProfile("Busy", SYS_BUSY, &busy);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(busy > SPIN / 2, 1);
+    rc = P2ClockProfile("Busy", P2_PROFILE_USER, &time);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(time < busy / 10, 1);
+    TEST(sleeper < spinner / 10, 1);
+    rc = P2ClockProfile("Nobody", P2_PROFILE_KERNEL, &time);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(time, 0);
+    P2ClockDumpProfile();
+
+    P2ClockShutdown();
+    PASSED();
+    return 0;
+}
+
+void test_setup(int argc, char **argv) {
+    // Do nothing.
+}
+
+void test_cleanup(int argc, char **argv) {}
+
+void finish(int argc, char **argv) {}
@@ -0,0 +1,308 @@
+/*
+ * bench_disk.c
+ *
+ * Disk scheduler benchmark. Creates a number of kernel-level workers that issue P2_DiskRead
+ * and P2_DiskWrite requests against disk 0 according to a workload, with at most "depth" 
+ * requests outstanding at any time. When all workers finish it prints a single line of
+ * key=value pairs starting with "BENCH" so that runs can be compared by a script. Run it
+ * with -R so that USLOSS uses virtual time and the results are deterministic; "make bench"
+ * does this for every workload.
+ *
+ * The benchmark is configured through environment variables:
+ *
+ *      BENCH_WORKLOAD  random, sequential, hotspot, or mixed (default random)
+ *      BENCH_WORKERS   # of worker processes (default 8)
+ *      BENCH_DEPTH     max. # of outstanding requests (default BENCH_WORKERS)
+ *      BENCH_REQUESTS  # of requests issued by each worker (default 50)
+ *      BENCH_SECTORS   # of sectors per request (default 4)
+ *      BENCH_TRACKS    size of the disk in tracks (default 100)
+ *      BENCH_SEED      random number seed (default 1)
+ *      BENCH_WRITEBACK 1 to use write-back mode (default 0)
+ *      BENCH_FAIR      1 to use fair queueing between workers (default 0)
+ *      BENCH_POLICY    sstf, elevator, fifo, or adaptive (default sstf)
+ *
+ * The seeks and the distance the disk head travelled are those the driver actually issued,
+ * from P2DiskGetStats.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <assert.h>
+#include <libuser.h>
+#include <libdisk.h>
+
+#include "tester.h"
+#include "phase2Int.h"
+
+#define UNIT        0
+#define MAX_WORKERS (P1_MAXPROC / 2)
+#define HOT_PERCENT 10  // size of the hot spot as a percentage of the disk
+#define HOT_HITS    90  // percentage of hotspot requests that go to the hot spot
+#define MIX_WRITES  50  // percentage of mixed requests that are writes
+
+#define LOCK(lid) { \
+    int _rc = P1_Lock(lid); \
+    assert(_rc == P1_SUCCESS); \
+}
+
+#define UNLOCK(lid) { \
+    int _rc = P1_Unlock(lid); \
+    assert(_rc == P1_SUCCESS); \
+}
+
+typedef enum Workload {
+    WORKLOAD_RANDOM,
+    WORKLOAD_SEQUENTIAL,
+    WORKLOAD_HOTSPOT,
+    WORKLOAD_MIXED
+} Workload;
+
+static char *workloadNames[] = {"random", "sequential", "hotspot", "mixed"};
+
+// indexed by P2_DISK_* policy
+static char *policyNames[] = {"sstf", "elevator", "fifo", "adaptive"};
+
+// configuration
+static Workload workload = WORKLOAD_RANDOM;
+static int      numWorkers = 8;
+static int      depth = -1;
+static int      numRequests = 50;
+static int      numSectors = 4;
+static int      tracks = 100;
+static int      seed = 1;
+static int      writeBack = FALSE;
+static int      fair = FALSE;
+static int      policy = P2_DISK_SSTF;
+static int      diskSectors;    // # of sectors on the disk
+
+// results, protected by lock
+static int      lock;
+static int      slotCond;       // signaled when an outstanding request completes
+static int      outstanding = 0;
+static int      completed = 0;
+static int      writes = 0;
+static int      *latencies;     // latency of each request in microseconds
+static int      passed = FALSE;
+
+static int
+EnvInt(char *name, int def)
+{
+    char *value = getenv(name);
+    return (value == NULL) ? def : atoi(value);
+}
+
+/*
+ * NextRequest
+ *
+ * Chooses the first sector of the next request for a worker and whether it is a write.
+ */
+static void
+NextRequest(int id, int i, unsigned int *state, int *first, int *write)
+{
+    int range = diskSectors - numSectors + 1;
+    int hot;
+
+    *write = FALSE;
+    switch (workload) {
+        case WORKLOAD_SEQUENTIAL:
+            // each worker walks its own contiguous region of the disk
+            *first = ((range / numWorkers) * id + (i * numSectors)) % range;
+            break;
+        case WORKLOAD_HOTSPOT:
+            hot = (range * HOT_PERCENT) / 100;
+            if ((hot > 0) && ((rand_r(state) % 100) < HOT_HITS)) {
+                *first = rand_r(state) % hot;
+            } else {
+                *first = rand_r(state) % range;
+            }
+            break;
+        case WORKLOAD_MIXED:
+            *first = rand_r(state) % range;
+            *write = (rand_r(state) % 100) < MIX_WRITES;
+            break;
+        case WORKLOAD_RANDOM:
+        default:
+            *first = rand_r(state) % range;
+            break;
+    }
+}
+
+static int
+Worker(void *arg)
+{
+    int             id = (int) arg;
+    unsigned int    state = seed + id;
+    char            *buffer = malloc(numSectors * USLOSS_DISK_SECTOR_SIZE);
+    int             rc;
+
+    assert(buffer != NULL);
+    memset(buffer, id, numSectors * USLOSS_DISK_SECTOR_SIZE);
+    for (int i = 0; i < numRequests; i++) {
+        int first, write, start, latency;
+
+        NextRequest(id, i, &state, &first, &write);
+
+        // wait for a free slot so that at most "depth" requests are outstanding.
+        LOCK(lock);
+        while (outstanding >= depth) {
+            rc = P1_Wait(slotCond);
+            assert(rc == P1_SUCCESS);
+        }
+        outstanding++;
+        UNLOCK(lock);
+
+        start = USLOSS_Clock();
+        if (write) {
+            rc = P2_DiskWrite(UNIT, first, numSectors, buffer);
+        } else {
+            rc = P2_DiskRead(UNIT, first, numSectors, buffer);
+        }
+        TEST_RC(rc, P1_SUCCESS);
+        latency = USLOSS_Clock() - start;
+
+        LOCK(lock);
+        latencies[completed++] = latency;
+        writes += write;
+        outstanding--;
+        rc = P1_Signal(slotCond);
+        assert(rc == P1_SUCCESS);
+        UNLOCK(lock);
+    }
+    free(buffer);
+    return 0;
+}
+
+static int
+CompareInts(const void *a, const void *b)
+{
+    return *((int *) a) - *((int *) b);
+}
+
+int P2_Startup(void *arg)
+{
+    int         rc, pid, status;
+    int         start, elapsed;
+    long long   total = 0;
+    P2DiskStats stats;
+
+    P2ClockInit();
+    P2DiskInit();
+
+    rc = P1_LockCreate("Bench Lock", &lock);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = P1_CondCreate("Bench Slots", lock, &slotCond);
+    TEST_RC(rc, P1_SUCCESS);
+    latencies = malloc(numWorkers * numRequests * sizeof(int));
+    assert(latencies != NULL);
+    rc = P2DiskSetWriteBack(UNIT, writeBack);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = P2DiskSetFair(UNIT, fair);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = P2DiskSetPolicy(UNIT, policy);
+    TEST_RC(rc, P1_SUCCESS);
+
+    start = USLOSS_Clock();
+    for (int i = 0; i < numWorkers; i++) {
+        rc = P1_Fork(MakeName("Worker", i), Worker, (void *) i, 4*USLOSS_MIN_STACK, 3, &pid);
+        TEST_RC(rc, P1_SUCCESS);
+    }
+    for (int i = 0; i < numWorkers; i++) {
+        rc = P1_Join(&pid, &status);
+        TEST_RC(rc, P1_SUCCESS);
+    }
+    rc = P2_DiskSync(UNIT);
+    TEST_RC(rc, P1_SUCCESS);
+    elapsed = USLOSS_Clock() - start;
+    TEST(completed, numWorkers * numRequests);
+
+    qsort(latencies, completed, sizeof(int), CompareInts);
+    for (int i = 0; i < completed; i++) {
+        total += latencies[i];
+    }
+    if (elapsed <= 0) {
+        elapsed = 1;
+    }
+    rc = P2DiskGetStats(UNIT, &stats);
+    TEST_RC(rc, P1_SUCCESS);
+    USLOSS_Console("BENCH workload=%s workers=%d depth=%d requests=%d sectors=%d writes=%d "
+                   "elapsed_us=%d iops=%.1f kbps=%.1f mean_us=%lld p99_us=%d seeks=%d "
+                   "seek_tracks=%d pool_hw=%d writeback=%d flushes=%d max_dirty=%d fair=%d "
+                   "policy=%s switches=%d\n",
+                   workloadNames[workload], numWorkers, depth, completed, numSectors, writes,
+                   elapsed, completed * 1000000.0 / elapsed,
+                   (completed * (double) numSectors * USLOSS_DISK_SECTOR_SIZE / 1024.0) * 
+                   1000000.0 / elapsed, total / completed, latencies[(completed * 99) / 100], 
+                   stats.seeks, stats.seekTracks, stats.poolHighWater, writeBack, stats.flushes, 
+                   stats.maxDirtyBytes, fair, policyNames[policy], stats.policySwitches);
+    free(latencies);
+
+    P2DiskShutdown();
+    P2ClockShutdown();
+    passed = TRUE;
+    return 0;
+}
+
+void test_setup(int argc, char **argv) {
+    int     rc;
+    char    *name = getenv("BENCH_WORKLOAD");
+    char    *policyName = getenv("BENCH_POLICY");
+
+    if (name != NULL) {
+        int found = FALSE;
+        for (int i = 0; i < sizeof(workloadNames) / sizeof(char *); i++) {
+            if (strcmp(name, workloadNames[i]) == 0) {
+                workload = (Workload) i;
+                found = TRUE;
+            }
+        }
+        if (!found) {
+            USLOSS_Console("Unknown workload \"%s\".\n", name);
+            USLOSS_Halt(1);
+        }
+    }
+    if (policyName != NULL) {
+        int found = FALSE;
+        for (int i = 0; i < sizeof(policyNames) / sizeof(char *); i++) {
+            if (strcmp(policyName, policyNames[i]) == 0) {
+                policy = i;
+                found = TRUE;
+            }
+        }
+        if (!found) {
+            USLOSS_Console("Unknown policy \"%s\".\n", policyName);
+            USLOSS_Halt(1);
+        }
+    }
+    numWorkers = EnvInt("BENCH_WORKERS", numWorkers);
+    depth = EnvInt("BENCH_DEPTH", numWorkers);
+    numRequests = EnvInt("BENCH_REQUESTS", numRequests);
+    numSectors = EnvInt("BENCH_SECTORS", numSectors);
+    tracks = EnvInt("BENCH_TRACKS", tracks);
+    seed = EnvInt("BENCH_SEED", seed);
+    writeBack = EnvInt("BENCH_WRITEBACK", writeBack);
+    fair = EnvInt("BENCH_FAIR", fair);
+    diskSectors = tracks * USLOSS_DISK_TRACK_SIZE;
+
+    if ((numWorkers < 1) || (numWorkers > MAX_WORKERS) || (depth < 1) || (numRequests < 1) ||
+        (numSectors < 1) || (numSectors > diskSectors)) {
+        USLOSS_Console("Invalid benchmark configuration.\n");
+        USLOSS_Halt(1);
+    }
+
+    DeleteAllDisks();
+    rc = Disk_Create(NULL, UNIT, tracks);
+    assert(rc == 0);
+}
+
+void test_cleanup(int argc, char **argv) {
+    DeleteAllDisks();
+    if (passed) {
+        PASSED_FINISH();
+    }
+}
+
+void finish(int argc, char **argv) {}
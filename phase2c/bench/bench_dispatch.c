@@ -0,0 +1,160 @@
+/*
+ * bench_dispatch.c
+ *
+ * Microbenchmark of the cost of choosing the next disk request as a function of the number of
+ * pending requests. For each queue depth it keeps that many requests on random tracks pending,
+ * repeatedly removes the one nearest the disk head, moves the head there, and adds a new request
+ * on a random track. It does this with a linear scan of a linked list, which is what the disk
+ * driver used to do, and with the pending-track bitmap the driver uses now. The times are
+ * measured with the host's clock, not USLOSS's, because virtual time doesn't reflect CPU cost.
+ *
+ * Configured through the environment variables BENCH_TRACKS (default 1000), BENCH_ITERATIONS
+ * (default 100000) and BENCH_SEED (default 1). Prints one line starting with "BENCH" per depth.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <assert.h>
+#include <libuser.h>
+
+#include "tester.h"
+#include "phase2Int.h"
+#include "trackmap.h"
+
+typedef struct Node {
+    int             track;
+    struct Node     *next;
+} Node;
+
+static int depths[] = {1, 4, 16, 64, 256, 1024};
+static int numDepths = sizeof(depths) / sizeof(int);
+
+static int tracks = 1000;
+static int iterations = 100000;
+static int seed = 1;
+
+static int
+EnvInt(char *name, int def)
+{
+    char *value = getenv(name);
+    return (value == NULL) ? def : atoi(value);
+}
+
+static double
+Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1e9) + ts.tv_nsec;
+}
+
+/*
+ * ListDispatch
+ *
+ * Chooses requests by scanning a linked list of all pending requests. Returns the elapsed
+ * time in nanoseconds.
+ */
+static double
+ListDispatch(int depth, Node *nodes)
+{
+    unsigned int    state = seed;
+    Node            *head = NULL;
+    int             track = 0;
+    double          start;
+
+    for (int i = 0; i < depth; i++) {
+        nodes[i].track = rand_r(&state) % tracks;
+        nodes[i].next = head;
+        head = &nodes[i];
+    }
+    start = Now();
+    for (int i = 0; i < iterations; i++) {
+        Node **best = &head;
+        for (Node **node = &head; *node != NULL; node = &(*node)->next) {
+            if (abs((*node)->track - track) < abs((*best)->track - track)) {
+                best = node;
+            }
+        }
+        Node *chosen = *best;
+        *best = chosen->next;
+        track = chosen->track;
+        chosen->track = rand_r(&state) % tracks;
+        chosen->next = head;
+        head = chosen;
+    }
+    return Now() - start;
+}
+
+/*
+ * MapDispatch
+ *
+ * Chooses requests with a pending-track bitmap and a count of requests per track. Returns the
+ * elapsed time in nanoseconds.
+ */
+static double
+MapDispatch(int depth, int *counts)
+{
+    unsigned int    state = seed;
+    TrackMap        map;
+    int             track = 0;
+    double          start;
+    int             rc;
+
+    rc = TrackMapInit(&map, tracks);
+    assert(rc == 0);
+    memset(counts, 0, tracks * sizeof(int));
+    for (int i = 0; i < depth; i++) {
+        int t = rand_r(&state) % tracks;
+        counts[t]++;
+        TrackMapSet(&map, t);
+    }
+    start = Now();
+    for (int i = 0; i < iterations; i++) {
+        track = TrackMapNearest(&map, track);
+        assert(track >= 0);
+        if (--counts[track] == 0) {
+            TrackMapClear(&map, track);
+        }
+        int t = rand_r(&state) % tracks;
+        counts[t]++;
+        TrackMapSet(&map, t);
+    }
+    start = Now() - start;
+    TrackMapFree(&map);
+    return start;
+}
+
+int P2_Startup(void *arg)
+{
+    Node    *nodes = malloc(depths[numDepths - 1] * sizeof(Node));
+    int     *counts = malloc(tracks * sizeof(int));
+
+    assert((nodes != NULL) && (counts != NULL));
+    for (int i = 0; i < numDepths; i++) {
+        double list = ListDispatch(depths[i], nodes);
+        double bitmap = MapDispatch(depths[i], counts);
+        USLOSS_Console("BENCH dispatch depth=%d tracks=%d iterations=%d list_ns=%.1f "
+                       "bitmap_ns=%.1f\n", depths[i], tracks, iterations, list / iterations, 
+                       bitmap / iterations);
+    }
+    free(nodes);
+    free(counts);
+    return 0;
+}
+
+void test_setup(int argc, char **argv) {
+    tracks = EnvInt("BENCH_TRACKS", tracks);
+    iterations = EnvInt("BENCH_ITERATIONS", iterations);
+    seed = EnvInt("BENCH_SEED", seed);
+    if ((tracks < 1) || (iterations < 1)) {
+        USLOSS_Console("Invalid benchmark configuration.\n");
+        USLOSS_Halt(1);
+    }
+}
+
+void test_cleanup(int argc, char **argv) {}
+
+void finish(int argc, char **argv) {}
@@ -7,12 +7,283 @@
 #include <phase1.h>
 
 #include "phase2Int.h"
+#include "trackmap.h"
 
+/*
+ * I/O priority classes. A request's class is derived from the priority of the process that
+ * issued it, i.e. the priority it was spawned with, except that paging requests made through
+ * P2DiskPageIn and P2DiskPageOut have a class of their own. The class determines the request's
+ * deadline and breaks ties between requests that are the same distance from the disk head.
+ * Paging requests are served before all others, page-ins first, so that a page fault never
+ * waits behind user I/O; they bypass throttling and the cache.
+ */
+typedef enum IoClass {
+    IO_CLASS_PAGING = 0,    // paging
+    IO_CLASS_RT,        // priorities 1-2, latency sensitive
+    IO_CLASS_BE,        // priorities 3-4, best effort
+    IO_CLASS_IDLE,      // priority 5 and lower, background
+    IO_CLASSES
+} IoClass;
+
+/*
+ * Maximum time in microseconds a request may wait before it is served ahead of requests
+ * that are closer to the disk head. Writes get more slack than reads because the issuing 
+ * process is less likely to be waiting on the result to make progress.
+ */
+static int deadlines[IO_CLASSES][2] = {
+//    read        write
+    {   20000,     200000},  // IO_CLASS_PAGING
+    {   50000,     500000},  // IO_CLASS_RT
+    {  500000,    5000000},  // IO_CLASS_BE
+    { 5000000,   10000000},  // IO_CLASS_IDLE
+};
+
+/*
+ * Per-process fair queueing and throttling. Each process has a weight, by default that of its
+ * I/O class, and optionally a limit in sectors per second enforced by a token bucket that the
+ * clock handler refills; a process without tokens waits before its request is queued. In fair
+ * mode the driver charges the sectors of each request it serves to the issuing process's virtual
+ * time, scaled by FAIR_SCALE and divided by the weight. It only serves requests of processes whose
+ * virtual time is within FAIR_SLACK of the least-served process with a pending request, and among
+ * those it still picks the nearest. Each process has at most one request pending per unit, so
+ * checking them costs at most P1_MAXPROC steps.
+ */
+#define FAIR_SCALE      64      // max. weight
+#define FAIR_SLACK      (USLOSS_DISK_TRACK_SIZE * FAIR_SCALE)
+#define TOKEN_SCALE     1000000LL   // tokens are sector-microseconds
+
+static int classWeights[IO_CLASSES] = {8, 4, 2, 1};
+
+typedef struct Tenant {
+    int             weight;     // share of the disk relative to other processes, 0 for default
+    int             rate;       // max. sectors per second, 0 if unlimited
+    long long       tokens;     // available sectors times TOKEN_SCALE
+    int             boost;      // priority inherited through a lock, 0 if none
+} Tenant;
+
+static Tenant       tenants[P1_MAXPROC];  // by pid, reset by DiskExit
+static int          tenantLock;     // protects tenants and lastRefill
+static int          tenantCond;     // broadcast when token buckets are refilled
+static int          lastRefill;     // time token buckets were last refilled
+
+/*
+ * Request descriptors are preallocated in a per-unit pool so that the I/O path never calls
+ * malloc nor creates or frees a condition variable. A process has at most one outstanding
+ * request, but a request can outlive a process that dies waiting for it, so the pool can run dry
+ * when pids are reused; a process then waits until the driver drops such a request.
+ */
+#define POOL_SIZE P1_MAXPROC
+
+/*
+ * A pending request is on two queues: the queue for its track, ordered by class, and the
+ * deadline queue for its class and operation, ordered by arrival and therefore by deadline.
+ * Both are doubly-linked so that a request can be removed from either in O(1).
+ */
+#define LINK_TRACK      0
+#define LINK_DEADLINE   1
+#define LINKS           2
+
+/*
+ * In write-back mode small writes are copied into a per-unit staging area and the caller returns
+ * right away. The driver writes the dirty sectors to the disk in sector order, and therefore in
+ * track order, every FLUSH_INTERVAL microseconds, when P2_DiskSync is called, when the staging
+ * area is full, and on shutdown. Writes of more than STAGE_DIRECT sectors bypass the staging area.
+ *
+ * The staging area doubles as a cache for ranges hinted P2_ADVISE_WILLNEED or
+ * P2_ADVISE_SEQUENTIAL with P2_DiskAdvise; nothing else is cached. Flushed sectors and the sectors
+ * of small reads in those ranges stay in it as clean slots on an LRU list until their slot is
+ * needed; a read whose sectors are all in the staging area doesn't go to the disk. Slots are
+ * taken from the free list first, then from the cold end of the LRU list, and only if there are
+ * no clean slots does the writer wait for a flush.
+ */
+#define STAGE_SECTORS   256
+#define STAGE_DIRECT    (STAGE_SECTORS / 4)
+#define FLUSH_INTERVAL  1000000
+
+/*
+ * How long a clean slot stays cached. RETAIN_LOW slots go on the cold end of the LRU list, so a
+ * scan only recycles its own slots; RETAIN_HIGH slots are moved back to the hot end the first
+ * time they reach the cold end.
+ */
+typedef enum Retain {
+    RETAIN_LOW = 0,
+    RETAIN_NORMAL,
+    RETAIN_HIGH,
+} Retain;
+
+typedef struct Stage {
+    int             sector;     // sector whose data this holds, -1 if free
+    int             dirty;      // written since the last flush started
+    int             flushing;   // being written by the current flush
+    int             stale;      // overwritten while being flushed, freed when the flush completes
+    int             cached;     // clean and on the LRU list
+    Retain          retain;     // retention of a clean slot
+    int             next;       // next free slot or next slot towards the hot end of the LRU list
+    int             prev;       // next slot towards the cold end of the LRU list
+    char            data[USLOSS_DISK_SECTOR_SIZE];
+} Stage;
+
+/*
+ * Access hints set with P2_DiskAdvise. Hints belong to the process that gave them and only
+ * affect its own requests, except that a sector is cached by a flush or readahead if any
+ * process hinted it and dropped if any process hinted P2_ADVISE_DONTNEED. A unit keeps the
+ * MAX_ADVICE most recent hints, which are removed when their process exits; where a process's
+ * hints overlap the most recent one applies. Reads in a P2_ADVISE_SEQUENTIAL range are
+ * scheduled one I/O class lower, leave their sectors at the cold end of the LRU list, and have
+ * the driver read up to READAHEAD sectors past them into the cache while it is idle.
+ * P2_ADVISE_WILLNEED ranges are read ahead right away, up to half the staging area, and cached
+ * with RETAIN_HIGH.
+ * P2_ADVISE_DONTNEED ranges are dropped from the cache and not cached again.
+ */
+#define MAX_ADVICE      16
+#define READAHEAD       (2 * USLOSS_DISK_TRACK_SIZE)
+
+typedef struct Advice {
+    int             pid;        // process that gave the hint
+    int             first;      // first sector of the range
+    int             sectors;    // # of sectors in the range, 0 if the entry is unused
+    int             advice;     // P2_ADVISE_*
+    int             seq;        // order in which hints were given
+} Advice;
+
+/*
+ * A unit's driver is forked by the first request to the unit, so units that aren't used cost
+ * nothing. The drivers are forked by the Disk Starter, a kernel process forked by P2DiskInit, so
+ * that they are all children of one process that joins them on shutdown. On shutdown the driver
+ * serves the requests already queued for up to DRAIN_LIMIT microseconds, then fails the rest
+ * with P1_WAIT_ABORTED, flushes the staging area and exits.
+ */
+#define DRAIN_LIMIT     1000000
+
+/*
+ * In adaptive mode the driver keeps a sliding window of the last WINDOW requests it served,
+ * recording the queue depth when each was chosen, whether it started where the previous request
+ * of the same process ended, and the seek distance to it. Every WINDOW / 2 requests it picks a
+ * policy: FIFO if the average queue depth is below ADAPT_DEPTH, in which case there is little to
+ * reorder; the elevator if at least ADAPT_SEQUENTIAL percent of requests were sequential, since
+ * sweeping keeps streams sequential without starving the far end of the disk; otherwise shortest
+ * seek first, which minimizes seeking for random requests.
+ */
+#define WINDOW              32
+#define ADAPT_DEPTH         150     // percent, i.e. 1.5 requests
+#define ADAPT_SEQUENTIAL    50
+
+typedef struct Sample {
+    int             depth;      // # of pending requests, including this one
+    int             sequential; // started after the previous request of the same process
+    int             seek;       // # of tracks the head moved
+} Sample;
+
+static char *policyNames[] = {"sstf", "elevator", "fifo", "adaptive"};
+
+typedef struct Link {
+    struct Request  *next;
+    struct Request  *prev;
+} Link;
+
+typedef struct Queue {
+    struct Request  *head;
+    struct Request  *tail;
+} Queue;
+
+typedef struct Request {
+    int             op;         // USLOSS_DISK_READ or USLOSS_DISK_WRITE
+    int             first;      // first sector
+    int             sectors;    // # of sectors
+    void            *buffer;    // data buffer
+    int             track;      // track of the first sector
+    IoClass         class;      // I/O priority class
+    int             arrival;    // time the request was queued
+    int             deadline;   // time by which the request should be started
+    int             pid;        // process that issued the request
+    int             weight;     // weight of the process for fair queueing
+    int             queued;     // request is pending in the unit's queues
+    int             done;       // request has been completed
+    int             cancelled;  // stop at the next track boundary
+    int             abandoned;  // the issuing process will never wait for the request
+    int             rc;         // return code
+    int             cond;       // waiting process waits on this for completion
+    Link            links[LINKS];   // LINK_TRACK is also used by the free list
+} Request;
+
+typedef struct Unit {
+    int             patchLock;  // serializes partial-sector writes
+    int             lock;       // protects the fields below
+    int             cond;       // signaled when a request is added or on shutdown
+    int             ready;      // broadcast when the # of tracks is known
+    int             tracks;     // # of tracks on the disk, -1 if unknown
+    int             track;      // current track of the disk head
+    int             shutdown;   // P2DiskShutdown has been called
+    int             started;    // the driver has been requested from the starter
+    int             running;    // the driver has been forked and hasn't exited
+    int             stopped;    // broadcast when the driver exits
+    int             startTime;  // time the driver was forked
+    int             shutdownTime;   // time P2DiskShutdown was called
+    int             pending;    // # of pending requests
+    TrackMap        map;        // tracks with pending requests
+    Queue           *trackQueues;                   // pending requests by track
+    Queue           deadlineQueues[IO_CLASSES][2];  // pending requests by class and op
+    Request         pool[POOL_SIZE];    // request descriptors
+    Request         *free;      // free list of request descriptors
+    int             freed;      // signaled when a descriptor is returned to the free list
+    Request         *slots[P1_MAXPROC]; // outstanding request of each process, by pid
+    int             inUse;      // # of descriptors in use
+    int             highWater;  // max. # of descriptors in use at once
+    int             writeBack;  // write-back mode is enabled
+    int             flushed;    // broadcast when a flush completes
+    int             flushWanted;    // the driver should flush the staging area
+    int             flushing;   // the driver is flushing the staging area
+    int             syncRequested;  // generation of the most recent flush request
+    int             synced;     // generation of the most recent completed flush
+    int             lastFlush;  // time the last flush completed
+    Stage           stage[STAGE_SECTORS];   // staging area
+    int             stageFree;  // free list of staging slots, -1 if empty
+    int             *stageOf;   // staging slot of each sector, -1 if none
+    int             dirty;      // # of dirty staging slots
+    int             lruHead;    // coldest clean staging slot, -1 if none
+    int             lruTail;    // hottest clean staging slot, -1 if none
+    int             cachedSlots;    // # of clean staging slots
+    Advice          advice[MAX_ADVICE]; // access hints
+    int             adviceSeq;  // seq of the most recent hint
+    int             raNext;     // next sector to read ahead
+    int             raEnd;      // end of the readahead window
+    P2DiskStats     stats;      // write-back and cache statistics
+    int             policy;     // P2_DISK_* scheduling policy
+    int             active;     // policy in effect, differs from policy in adaptive mode
+    int             direction;  // elevator direction, 1 for up and -1 for down
+    Sample          window[WINDOW]; // most recent requests served, a ring buffer
+    int             windowNext; // next entry of window to fill
+    int             samples;    // # of valid entries in window
+    int             sinceAdapt; // # of requests served since the policy was last chosen
+    int             depthSum;   // sum of the depths in window
+    int             sequentialSum;  // # of sequential requests in window
+    int             seekSum;    // sum of the seek distances in window
+    int             ends[P1_MAXPROC];   // sector after the last request of each process, by pid
+    int             fair;       // fair queueing is enabled
+    int             vtime;      // virtual time of the request most recently served
+    int             vtimes[P1_MAXPROC]; // virtual time of each process, by pid
+} Unit;
+
+static Unit         units[USLOSS_DISK_UNITS];
+
+static int          starterPid = -1;
+static int          starterLock;
+static int          starterCond;    // signaled when a driver is requested or on shutdown
+static int          starterStop;    // the starter should join the drivers and exit
 
 static int      DiskDriver(void *);
+static int      DiskStarter(void *);
 static void     ReadStub(USLOSS_Sysargs *sysargs);
 static void     WriteStub(USLOSS_Sysargs *sysargs);
 static void     SizeStub(USLOSS_Sysargs *sysargs);
+static void     SyncStub(USLOSS_Sysargs *sysargs);
+static void     AdviseStub(USLOSS_Sysargs *sysargs);
+static void     PReadStub(USLOSS_Sysargs *sysargs);
+static void     PWriteStub(USLOSS_Sysargs *sysargs);
+static void     DiskTick(int now);
+static void     DiskExit(int pid);
+static void     FreeRequest(Unit *u, Request *req);
+static void     Orphan(Unit *u, int pid);
 
 static char *
 MakeName(char *prefix, int suffix)
@@ -22,72 +293,1745 @@ MakeName(char *prefix, int suffix)
     return name;
 }
 
+#define LOCK(lid) { \
+    int _rc = P1_Lock(lid); \
+    assert(_rc == P1_SUCCESS); \
+}
+
+#define UNLOCK(lid) { \
+    int _rc = P1_Unlock(lid); \
+    assert(_rc == P1_SUCCESS); \
+}
+
+/*
+ * P2DiskInit
+ *
+ * Initialize the disk data structures and fork the Disk Starter, which forks the disk drivers
+ * on demand.
+ */
+void 
+P2DiskInit(void) 
+{
+#ifdef DEBUG
+    int start = USLOSS_Clock();
+#endif
+    int rc;
+
+    // initialize data structures here including lock and condition variables
+
+    rc = P1_LockCreate("Disk Tenants", &tenantLock);
+    assert(rc == P1_SUCCESS);
+    rc = P1_CondCreate("Disk Tokens", tenantLock, &tenantCond);
+    assert(rc == P1_SUCCESS);
+    memset(tenants, 0, sizeof(tenants));
+
+    for (int unit = 0; unit < USLOSS_DISK_UNITS; unit++) {
+        Unit *u = &units[unit];
+        memset(u, 0, sizeof(*u));
+        u->tracks = -1;
+        rc = P1_LockCreate(MakeName("Disk Lock ", unit), &u->lock);
+        assert(rc == P1_SUCCESS);
+        rc = P1_LockCreate(MakeName("Disk Patch ", unit), &u->patchLock);
+        assert(rc == P1_SUCCESS);
+        rc = P1_CondCreate(MakeName("Disk Cond ", unit), u->lock, &u->cond);
+        assert(rc == P1_SUCCESS);
+        rc = P1_CondCreate(MakeName("Disk Ready ", unit), u->lock, &u->ready);
+        assert(rc == P1_SUCCESS);
+        rc = P1_CondCreate(MakeName("Disk Flushed ", unit), u->lock, &u->flushed);
+        assert(rc == P1_SUCCESS);
+        rc = P1_CondCreate(MakeName("Disk Stopped ", unit), u->lock, &u->stopped);
+        assert(rc == P1_SUCCESS);
+        rc = P1_CondCreate(MakeName("Disk Freed ", unit), u->lock, &u->freed);
+        assert(rc == P1_SUCCESS);
+        for (int i = 0; i < STAGE_SECTORS; i++) {
+            u->stage[i].sector = -1;
+            u->stage[i].next = (i < STAGE_SECTORS - 1) ? i + 1 : -1;
+        }
+        u->stageFree = 0;
+        u->lruHead = u->lruTail = -1;
+        u->direction = 1;
+        for (int i = 0; i < P1_MAXPROC; i++) {
+            u->ends[i] = -1;
+        }
+        for (int i = POOL_SIZE - 1; i >= 0; i--) {
+            Request *req = &u->pool[i];
+            char    name[P1_MAXNAME];
+            snprintf(name, sizeof(name), "Disk Request %d.%d", unit, i);
+            rc = P1_CondCreate(name, u->lock, &req->cond);
+            assert(rc == P1_SUCCESS);
+            req->links[LINK_TRACK].next = u->free;
+            u->free = req;
+        }
+    }
+
+    P2SwapSetup();
+
+    rc = P2_SetSyscallHandler(SYS_DISKREAD, ReadStub);
+    assert(rc == P1_SUCCESS);
+
+    rc = P2_SetSyscallHandler(SYS_DISKWRITE, WriteStub);
+    assert(rc == P1_SUCCESS);
+
+    rc = P2_SetSyscallHandler(SYS_DISKSIZE, SizeStub);
+    assert(rc == P1_SUCCESS);
+
+    rc = P2_SetSyscallHandler(SYS_DISKSYNC, SyncStub);
+    assert(rc == P1_SUCCESS);
+
+    rc = P2_SetSyscallHandler(SYS_DISKADVISE, AdviseStub);
+    assert(rc == P1_SUCCESS);
+
+    rc = P2_SetSyscallHandler(SYS_DISKPREAD, PReadStub);
+    assert(rc == P1_SUCCESS);
+
+    rc = P2_SetSyscallHandler(SYS_DISKPWRITE, PWriteStub);
+    assert(rc == P1_SUCCESS);
+
+    rc = P2ClockRegister(DiskTick);
+    assert(rc == P1_SUCCESS);
+
+    rc = P2ProcRegisterExit(DiskExit);
+    assert(rc == P1_SUCCESS);
+
+    rc = P1_LockCreate("Disk Starter", &starterLock);
+    assert(rc == P1_SUCCESS);
+    rc = P1_CondCreate("Disk Starter", starterLock, &starterCond);
+    assert(rc == P1_SUCCESS);
+    starterStop = FALSE;
+    rc = P1_Fork("Disk Starter", DiskStarter, NULL, USLOSS_MIN_STACK*2, 1, &starterPid);
+    assert(rc == P1_SUCCESS);
+
+#ifdef DEBUG
+    USLOSS_Console("Disk: initialized in %d us.\n", USLOSS_Clock() - start);
+#endif
+}
+
+/*
+ * P2DiskShutdown
+ *
+ * Stop the disk drivers, waiting for each to drain its queue and flush its staging area. The
+ * wait is bounded by DRAIN_LIMIT plus the time to finish the current track and flush. Must be
+ * called by the process that called P2DiskInit, after it has joined its other children, because
+ * the Disk Starter is its child and is joined here.
+ */
+
+void 
+P2DiskShutdown(void) 
+{
+    int start = USLOSS_Clock();
+    int rc, pid, status;
+
+    for (int unit = 0; unit < USLOSS_DISK_UNITS; unit++) {
+        Unit *u = &units[unit];
+        LOCK(u->lock);
+        u->shutdown = TRUE;
+        u->shutdownTime = start;
+        rc = P1_Signal(u->cond);
+        assert(rc == P1_SUCCESS);
+        UNLOCK(u->lock);
+    }
+    LOCK(starterLock);
+    starterStop = TRUE;
+    rc = P1_Signal(starterCond);
+    assert(rc == P1_SUCCESS);
+    UNLOCK(starterLock);
+    for (int unit = 0; unit < USLOSS_DISK_UNITS; unit++) {
+        Unit *u = &units[unit];
+        LOCK(u->lock);
+        while (u->running) {
+            rc = P1_Wait(u->stopped);
+            assert(rc == P1_SUCCESS);
+        }
+#ifdef DEBUG
+        if (u->started) {
+            USLOSS_Console("Disk %d: started in %d us, drained in %d us, %d requests abandoned.\n",
+                           unit, u->stats.startLatency, u->stats.drainLatency, 
+                           u->stats.abandoned);
+        }
+#endif
+        UNLOCK(u->lock);
+    }
+    rc = P1_Join(&pid, &status);
+    assert(rc == P1_SUCCESS);
+    assert(pid == starterPid);
+    starterPid = -1;
+#ifdef DEBUG
+    USLOSS_Console("Disk: shut down in %d us.\n", USLOSS_Clock() - start);
+#endif
+}
+
+/*
+ * DiskOp
+ *
+ * Performs a single disk operation and waits for it to finish. Returns P1_INVALID_UNIT if
+ * the disk rejected or failed the operation, e.g. because the unit does not exist.
+ */
+static int
+DiskOp(int unit, int opr, void *reg1, void *reg2)
+{
+    USLOSS_DeviceRequest    request;
+    int                     status;
+    int                     rc;
+
+    request.opr = opr;
+    request.reg1 = reg1;
+    request.reg2 = reg2;
+    rc = USLOSS_DeviceOutput(USLOSS_DISK_DEV, unit, &request);
+    if (rc != USLOSS_DEV_OK) {
+        return P1_INVALID_UNIT;
+    }
+    rc = P1_DeviceWait(USLOSS_DISK_DEV, unit, &status);
+    if ((rc == P1_SUCCESS) && (status == USLOSS_DEV_ERROR)) {
+        rc = P1_INVALID_UNIT;
+    }
+    return rc;
+}
+
+/*
+ * Seek
+ *
+ * Moves the disk head to the track if it isn't there already, counting the seek in the unit's
+ * statistics. Only the driver calls this, so u->track needs no lock.
+ */
+static int
+Seek(int unit, int track)
+{
+    Unit    *u = &units[unit];
+    int     rc;
+
+    if (track == u->track) {
+        return P1_SUCCESS;
+    }
+    rc = DiskOp(unit, USLOSS_DISK_SEEK, (void *) track, NULL);
+    if (rc == P1_SUCCESS) {
+        LOCK(u->lock);
+        u->stats.seeks++;
+        u->stats.seekTracks += abs(track - u->track);
+        UNLOCK(u->lock);
+        u->track = track;
+    }
+    return rc;
+}
+
+/*
+ * QueueInsert
+ *
+ * Inserts a request into a queue after the specified request, or at the head if it is NULL.
+ */
+static void
+QueueInsert(Queue *q, Request *after, Request *req, int link)
+{
+    Request *next = (after == NULL) ? q->head : after->links[link].next;
+
+    req->links[link].prev = after;
+    req->links[link].next = next;
+    if (after == NULL) {
+        q->head = req;
+    } else {
+        after->links[link].next = req;
+    }
+    if (next == NULL) {
+        q->tail = req;
+    } else {
+        next->links[link].prev = req;
+    }
+}
+
+static void
+QueueRemove(Queue *q, Request *req, int link)
+{
+    Request *prev = req->links[link].prev;
+    Request *next = req->links[link].next;
+
+    if (prev == NULL) {
+        q->head = next;
+    } else {
+        prev->links[link].next = next;
+    }
+    if (next == NULL) {
+        q->tail = prev;
+    } else {
+        next->links[link].prev = prev;
+    }
+    req->links[link].next = req->links[link].prev = NULL;
+}
+
+/*
+ * Enqueue
+ *
+ * Adds a request to the unit's pending requests. Within its track the request goes after those
+ * of the same or a more urgent class. The deadline queue is kept in arrival order; a new request
+ * goes at its tail, a reclassified one may not. Must be called with the unit's lock held.
+ */
+static void
+Enqueue(Unit *u, Request *req)
+{
+    Queue   *q = &u->trackQueues[req->track];
+    Request *after = q->tail;
+
+    while ((after != NULL) && (after->class > req->class)) {
+        after = after->links[LINK_TRACK].prev;
+    }
+    QueueInsert(q, after, req, LINK_TRACK);
+    TrackMapSet(&u->map, req->track);
+    q = &u->deadlineQueues[req->class][req->op == USLOSS_DISK_WRITE];
+    after = q->tail;
+    while ((after != NULL) && ((after->arrival - req->arrival) > 0)) {
+        after = after->links[LINK_DEADLINE].prev;
+    }
+    QueueInsert(q, after, req, LINK_DEADLINE);
+    req->queued = TRUE;
+    u->pending++;
+}
+
+/*
+ * Dequeue
+ *
+ * Removes a request from the unit's pending requests. Must be called with the unit's lock held.
+ */
+static void
+Dequeue(Unit *u, Request *req)
+{
+    Queue *q = &u->trackQueues[req->track];
+
+    QueueRemove(q, req, LINK_TRACK);
+    if (q->head == NULL) {
+        TrackMapClear(&u->map, req->track);
+    }
+    QueueRemove(&u->deadlineQueues[req->class][req->op == USLOSS_DISK_WRITE], req, 
+                LINK_DEADLINE);
+    req->queued = FALSE;
+    u->pending--;
+}
+
+/*
+ * FairChoice
+ *
+ * Returns the shortest-seek request if its process is within its fair share, otherwise the
+ * nearest request of a process that is. Must be called with the unit's lock held.
+ */
+static Request *
+FairChoice(Unit *u, Request *nearest)
+{
+    Request *best = NULL;
+    int     minTime = 0;
+    int     found = FALSE;
+    int     bestDistance = 0;
+
+    for (int class = 0; class < IO_CLASSES; class++) {
+        for (int op = 0; op < 2; op++) {
+            for (Request *req = u->deadlineQueues[class][op].head; req != NULL; 
+                 req = req->links[LINK_DEADLINE].next) {
+                int vtime = u->vtimes[req->pid];
+                if (!found || ((vtime - minTime) < 0)) {
+                    minTime = vtime;
+                    found = TRUE;
+                }
+            }
+        }
+    }
+    if ((u->vtimes[nearest->pid] - minTime) <= FAIR_SLACK) {
+        return nearest;
+    }
+    for (int class = 0; class < IO_CLASSES; class++) {
+        for (int op = 0; op < 2; op++) {
+            for (Request *req = u->deadlineQueues[class][op].head; req != NULL; 
+                 req = req->links[LINK_DEADLINE].next) {
+                int distance = abs(req->track - u->track);
+                if (((u->vtimes[req->pid] - minTime) <= FAIR_SLACK) &&
+                    ((best == NULL) || (distance < bestDistance))) {
+                    best = req;
+                    bestDistance = distance;
+                }
+            }
+        }
+    }
+    assert(best != NULL);
+    return best;
+}
+
+/*
+ * Nearest
+ *
+ * Returns the request at the head of the nearest non-empty track, with ties between the track
+ * above and the track below the disk head broken by class and then deadline. Must be called
+ * with the unit's lock held and requests pending.
+ */
+static Request *
+Nearest(Unit *u)
+{
+    Request     *best;
+    int         track, mirror;
+
+    // TrackMapNearest prefers the track below on a tie, so check the one as far above
+    track = TrackMapNearest(&u->map, u->track);
+    assert(track >= 0);
+    best = u->trackQueues[track].head;
+    mirror = u->track + (u->track - track);
+    if ((track < u->track) && (mirror < u->tracks) &&
+        (TrackMapNext(&u->map, mirror, mirror) == mirror)) {
+        Request *above = u->trackQueues[mirror].head;
+        if (above->class != best->class) {
+            best = (above->class < best->class) ? above : best;
+        } else {
+            best = ((above->deadline - best->deadline) < 0) ? above : best;
+        }
+    }
+    return best;
+}
+
+/*
+ * Sweep
+ *
+ * Returns the request at the head of the nearest non-empty track in the elevator's direction,
+ * reversing the direction if there is none. Must be called with the unit's lock held and
+ * requests pending.
+ */
+static Request *
+Sweep(Unit *u)
+{
+    int track;
+
+    if (u->direction > 0) {
+        track = TrackMapNext(&u->map, u->track, u->tracks - 1);
+        if (track < 0) {
+            u->direction = -1;
+            track = TrackMapPrev(&u->map, u->track, 0);
+        }
+    } else {
+        track = TrackMapPrev(&u->map, u->track, 0);
+        if (track < 0) {
+            u->direction = 1;
+            track = TrackMapNext(&u->map, u->track, u->tracks - 1);
+        }
+    }
+    assert(track >= 0);
+    return u->trackQueues[track].head;
+}
+
+/*
+ * Oldest
+ *
+ * Returns the request that arrived first. Each deadline queue is in arrival order so only
+ * their heads need to be checked. Must be called with the unit's lock held.
+ */
+static Request *
+Oldest(Unit *u)
+{
+    Request *best = NULL;
+
+    for (int class = 0; class < IO_CLASSES; class++) {
+        for (int op = 0; op < 2; op++) {
+            Request *req = u->deadlineQueues[class][op].head;
+            if ((req != NULL) && ((best == NULL) || ((req->arrival - best->arrival) < 0))) {
+                best = req;
+            }
+        }
+    }
+    return best;
+}
+
+/*
+ * Adapt
+ *
+ * Records a request that is about to be served in the sliding window and, in adaptive mode,
+ * chooses the policy every WINDOW / 2 requests once the window is full. Must be called with
+ * the unit's lock held, before the request is dequeued.
+ */
+static void
+Adapt(Unit *u, Request *req)
+{
+    Sample  *sample = &u->window[u->windowNext];
+    int     policy;
+    char    *reason;
+
+    if (u->samples == WINDOW) {
+        u->depthSum -= sample->depth;
+        u->sequentialSum -= sample->sequential;
+        u->seekSum -= sample->seek;
+    } else {
+        u->samples++;
+    }
+    sample->depth = u->pending;
+    sample->sequential = (req->first == u->ends[req->pid]);
+    sample->seek = abs(req->track - u->track);
+    u->depthSum += sample->depth;
+    u->sequentialSum += sample->sequential;
+    u->seekSum += sample->seek;
+    u->windowNext = (u->windowNext + 1) % WINDOW;
+    u->ends[req->pid] = req->first + req->sectors;
+
+    if ((u->policy != P2_DISK_ADAPTIVE) || (u->samples < WINDOW) || 
+        (++u->sinceAdapt < WINDOW / 2)) {
+        return;
+    }
+    u->sinceAdapt = 0;
+    if (u->depthSum * 100 < ADAPT_DEPTH * WINDOW) {
+        policy = P2_DISK_FIFO;
+        reason = "queue is shallow";
+    } else if (u->sequentialSum * 100 >= ADAPT_SEQUENTIAL * WINDOW) {
+        policy = P2_DISK_ELEVATOR;
+        reason = "requests are sequential";
+    } else {
+        policy = P2_DISK_SSTF;
+        reason = "requests are random";
+    }
+    if (policy != u->active) {
+        USLOSS_Console("Disk %d: switching from %s to %s, %s (avg. depth %d.%02d, %d%% sequential, "
+                       "avg. seek %d tracks).\n", (int) (u - units), policyNames[u->active],
+                       policyNames[policy], reason, u->depthSum / WINDOW, 
+                       ((u->depthSum * 100) / WINDOW) % 100, (u->sequentialSum * 100) / WINDOW,
+                       u->seekSum / WINDOW);
+        u->active = policy;
+        u->stats.policySwitches++;
+    }
+}
+
+/*
+ * ChooseRequest
+ *
+ * Removes and returns the next request to serve. Paging requests are served first, in
+ * arrival order. Then requests whose deadline has passed, highest class then earliest
+ * deadline; only the head of each deadline queue needs to be checked. Otherwise the request is
+ * chosen by the policy in effect; in fair mode the choice of the seek-based policies is then
+ * limited to processes within their share.
+ * Must be called with the unit's lock held and requests pending.
+ */
+static Request *
+ChooseRequest(Unit *u)
+{
+    Request     *best;
+    int         now = USLOSS_Clock();
+
+    // serve paging requests first, page-ins before page-outs
+    best = u->deadlineQueues[IO_CLASS_PAGING][0].head;
+    if (best == NULL) {
+        best = u->deadlineQueues[IO_CLASS_PAGING][1].head;
+    }
+
+    // then the most urgent expired request, if any
+    for (int class = IO_CLASS_RT; (class < IO_CLASSES) && (best == NULL); class++) {
+        for (int op = 0; op < 2; op++) {
+            Request *req = u->deadlineQueues[class][op].head;
+            if ((req != NULL) && ((now - req->deadline) >= 0) &&
+                ((best == NULL) || ((req->deadline - best->deadline) < 0))) {
+                best = req;
+            }
+        }
+    }
+    if (best == NULL) {
+        switch (u->active) {
+            case P2_DISK_FIFO:
+                best = Oldest(u);
+                break;
+            case P2_DISK_ELEVATOR:
+                best = Sweep(u);
+                break;
+            default:
+                best = Nearest(u);
+                break;
+        }
+        if (u->fair && (u->active != P2_DISK_FIFO)) {
+            best = FairChoice(u, best);
+        }
+    }
+    assert(best != NULL);
+    Adapt(u, best);
+    Dequeue(u, best);
+
+    // charge the request to its process
+    u->vtime = u->vtimes[best->pid];
+    u->vtimes[best->pid] += (best->sectors * FAIR_SCALE) / best->weight;
+    return best;
+}
+
+/*
+ * DoRequest
+ *
+ * Performs the disk operations for a request, seeking to each track as necessary. Returns
+ * P1_WAIT_ABORTED if the request was cancelled or its issuing process is no longer waiting for
+ * it; this is checked at each track boundary, including before the first.
+ */
+static int
+DoRequest(int unit, Request *req)
+{
+    Unit    *u = &units[unit];
+    char    *buffer = (char *) req->buffer;
+    int     rc = P1_SUCCESS;
+
+    for (int i = 0; i < req->sectors; i++) {
+        int sector = req->first + i;
+        int track = sector / USLOSS_DISK_TRACK_SIZE;
+        if ((i == 0) || ((sector % USLOSS_DISK_TRACK_SIZE) == 0)) {
+            int cancelled;
+            LOCK(u->lock);
+            cancelled = req->cancelled || 
+                        (u->shutdown && ((USLOSS_Clock() - u->shutdownTime) >= DRAIN_LIMIT));
+            UNLOCK(u->lock);
+            if (cancelled) {
+                rc = P1_WAIT_ABORTED;
+                break;
+            }
+        }
+        rc = Seek(unit, track);
+        if (rc != P1_SUCCESS) {
+            break;
+        }
+        rc = DiskOp(unit, req->op, (void *) (sector % USLOSS_DISK_TRACK_SIZE), 
+                    buffer + (i * USLOSS_DISK_SECTOR_SIZE));
+        if (rc != P1_SUCCESS) {
+            break;
+        }
+    }
+    return rc;
+}
+
+/*
+ * StartUnit
+ *
+ * Determines the size of the disk and sets up the index of pending requests. A unit whose
+ * size cannot be determined is treated as having no tracks.
+ */
+static void
+StartUnit(int unit)
+{
+    Unit    *u = &units[unit];
+    int     tracks = 0;
+    int     rc;
+
+    rc = DiskOp(unit, USLOSS_DISK_TRACKS, &tracks, NULL);
+    if (rc != P1_SUCCESS) {
+        tracks = 0;
+    }
+    LOCK(u->lock);
+    rc = TrackMapInit(&u->map, tracks);
+    assert(rc == 0);
+    u->trackQueues = calloc((tracks > 0) ? tracks : 1, sizeof(Queue));
+    assert(u->trackQueues != NULL);
+    u->stageOf = malloc(((tracks > 0) ? tracks : 1) * USLOSS_DISK_TRACK_SIZE * sizeof(int));
+    assert(u->stageOf != NULL);
+    memset(u->stageOf, -1, ((tracks > 0) ? tracks : 1) * USLOSS_DISK_TRACK_SIZE * sizeof(int));
+    u->tracks = tracks;
+    u->stats.startLatency = USLOSS_Clock() - u->startTime;
+    rc = P1_Broadcast(u->ready);
+    assert(rc == P1_SUCCESS);
+    UNLOCK(u->lock);
+}
+
+/*
+ * Overlay
+ *
+ * Copies staged sectors that have not yet been written to the disk into the buffer of a read
+ * that the driver just performed. Must be called with the unit's lock held.
+ */
+static void
+Overlay(Unit *u, Request *req)
+{
+    for (int i = 0; i < req->sectors; i++) {
+        int slot = u->stageOf[req->first + i];
+        if (slot >= 0) {
+            memcpy((char *) req->buffer + (i * USLOSS_DISK_SECTOR_SIZE), u->stage[slot].data,
+                   USLOSS_DISK_SECTOR_SIZE);
+        }
+    }
+}
+
+/*
+ * FindAdvice
+ *
+ * Returns the access hint of the process that applies to a sector, NULL if none. A pid of -1
+ * finds the most recent hint of any process. Must be called with the unit's lock held.
+ */
+static Advice *
+FindAdvice(Unit *u, int pid, int sector)
+{
+    Advice  *best = NULL;
+
+    for (int i = 0; i < MAX_ADVICE; i++) {
+        Advice *a = &u->advice[i];
+        if ((a->sectors > 0) && ((pid == -1) || (a->pid == pid)) && (sector >= a->first) &&
+            (sector < a->first + a->sectors) && ((best == NULL) || ((a->seq - best->seq) > 0))) {
+            best = a;
+        }
+    }
+    return best;
+}
+
+static int
+GetAdvice(Unit *u, int pid, int sector)
+{
+    Advice *a = FindAdvice(u, pid, sector);
+    return (a == NULL) ? P2_ADVISE_NORMAL : a->advice;
+}
+
+/*
+ * Cacheable
+ *
+ * Returns TRUE if the process, or any process for a pid of -1, hinted that the sector is worth
+ * caching. Must be called with the unit's lock held.
+ */
+static int
+Cacheable(Unit *u, int pid, int sector)
+{
+    int advice = GetAdvice(u, pid, sector);
+    return (advice == P2_ADVISE_WILLNEED) || (advice == P2_ADVISE_SEQUENTIAL);
+}
+
+/*
+ * GetRetention
+ *
+ * Returns how long a sector should stay cached according to the process's hints, or any
+ * process's for a pid of -1. Must be called with the unit's lock held.
+ */
+static Retain
+GetRetention(Unit *u, int pid, int sector)
+{
+    switch (GetAdvice(u, pid, sector)) {
+        case P2_ADVISE_SEQUENTIAL:
+        case P2_ADVISE_DONTNEED:
+            return RETAIN_LOW;
+        case P2_ADVISE_WILLNEED:
+            return RETAIN_HIGH;
+        default:
+            return RETAIN_NORMAL;
+    }
+}
+
+static void
+LruRemove(Unit *u, int slot)
+{
+    Stage *st = &u->stage[slot];
+
+    if (st->prev < 0) {
+        u->lruHead = st->next;
+    } else {
+        u->stage[st->prev].next = st->next;
+    }
+    if (st->next < 0) {
+        u->lruTail = st->prev;
+    } else {
+        u->stage[st->next].prev = st->prev;
+    }
+    st->next = st->prev = -1;
+    st->cached = FALSE;
+    u->cachedSlots--;
+}
+
+/*
+ * CacheInsert
+ *
+ * Puts a clean staging slot on the LRU list, at the cold end if its retention is RETAIN_LOW and
+ * at the hot end otherwise. Must be called with the unit's lock held.
+ */
+static void
+CacheInsert(Unit *u, int slot, Retain retain)
+{
+    Stage *st = &u->stage[slot];
+
+    assert(!st->cached);
+    st->retain = retain;
+    st->cached = TRUE;
+    u->cachedSlots++;
+    if (retain == RETAIN_LOW) {
+        st->prev = -1;
+        st->next = u->lruHead;
+        if (u->lruHead < 0) {
+            u->lruTail = slot;
+        } else {
+            u->stage[u->lruHead].prev = slot;
+        }
+        u->lruHead = slot;
+    } else {
+        st->next = -1;
+        st->prev = u->lruTail;
+        if (u->lruTail < 0) {
+            u->lruHead = slot;
+        } else {
+            u->stage[u->lruTail].next = slot;
+        }
+        u->lruTail = slot;
+    }
+}
+
+/*
+ * CacheTouch
+ *
+ * Records a hit on a clean staging slot by moving it to the hot end of the LRU list, or to the
+ * cold end if the reader is scanning and won't need it again. RETAIN_HIGH slots stay RETAIN_HIGH.
+ * Must be called with the unit's lock held.
+ */
+static void
+CacheTouch(Unit *u, int slot, Retain retain)
+{
+    Stage *st = &u->stage[slot];
+
+    if (st->cached) {
+        if (st->retain == RETAIN_HIGH) {
+            retain = RETAIN_HIGH;
+        }
+        LruRemove(u, slot);
+        CacheInsert(u, slot, retain);
+    }
+}
+
+static void
+FreeSlot(Unit *u, int slot)
+{
+    Stage *st = &u->stage[slot];
+
+    if (st->cached) {
+        LruRemove(u, slot);
+    }
+    st->sector = -1;
+    st->next = u->stageFree;
+    u->stageFree = slot;
+}
+
+/*
+ * AllocSlot
+ *
+ * Assigns a staging slot to a sector that doesn't have one, evicting the least recently used
+ * clean slot if there are no free slots. Returns -1 if all slots are dirty or being flushed.
+ * Must be called with the unit's lock held.
+ */
+static int
+AllocSlot(Unit *u, int sector)
+{
+    int     slot = u->stageFree;
+    Stage   *st;
+
+    assert(u->stageOf[sector] < 0);
+    if (slot >= 0) {
+        u->stageFree = u->stage[slot].next;
+    } else {
+        for (slot = u->lruHead; slot >= 0; slot = u->lruHead) {
+            st = &u->stage[slot];
+            LruRemove(u, slot);
+            if (st->retain != RETAIN_HIGH) {
+                break;
+            }
+            // second chance
+            CacheInsert(u, slot, RETAIN_NORMAL);
+        }
+        if (slot < 0) {
+            return -1;
+        }
+        u->stageOf[u->stage[slot].sector] = -1;
+    }
+    st = &u->stage[slot];
+    st->sector = sector;
+    st->dirty = FALSE;
+    st->flushing = FALSE;
+    st->stale = FALSE;
+    st->cached = FALSE;
+    st->next = st->prev = -1;
+    u->stageOf[sector] = slot;
+    return slot;
+}
+
+/*
+ * DropStaged
+ *
+ * Discards staged and cached copies of sectors that are about to be overwritten by a write that
+ * bypasses the staging area. A slot that is being flushed is freed when the flush completes, which
+ * is before the write is performed. Must be called with the unit's lock held.
+ */
+static void
+DropStaged(Unit *u, int first, int sectors)
+{
+    for (int sector = first; sector < first + sectors; sector++) {
+        int     slot = u->stageOf[sector];
+        Stage   *st;
+
+        if (slot < 0) {
+            continue;
+        }
+        st = &u->stage[slot];
+        u->stageOf[sector] = -1;
+        if (st->dirty) {
+            st->dirty = FALSE;
+            u->dirty--;
+        }
+        if (st->flushing) {
+            st->stale = TRUE;
+        } else {
+            FreeSlot(u, slot);
+        }
+    }
+}
+
+/*
+ * Uncache
+ *
+ * Drops the clean cached copies of sectors, leaving dirty ones to be flushed. Must be called with
+ * the unit's lock held.
+ */
+static void
+Uncache(Unit *u, int first, int sectors)
+{
+    for (int sector = first; sector < first + sectors; sector++) {
+        int slot = u->stageOf[sector];
+        if ((slot >= 0) && u->stage[slot].cached) {
+            u->stageOf[sector] = -1;
+            FreeSlot(u, slot);
+        }
+    }
+}
+
+/*
+ * Fill
+ *
+ * Caches the sectors of a small read that the driver just performed that the reader hinted are
+ * worth caching. Stops when there are no free or clean slots. Must be called with the unit's
+ * lock held.
+ */
+static void
+Fill(Unit *u, Request *req)
+{
+    if (req->sectors > STAGE_DIRECT) {
+        return;
+    }
+    for (int i = 0; i < req->sectors; i++) {
+        int     sector = req->first + i;
+        int     slot = u->stageOf[sector];
+        Retain  retain = GetRetention(u, req->pid, sector);
+
+        if (!Cacheable(u, req->pid, sector)) {
+            continue;
+        }
+        if (slot >= 0) {
+            CacheTouch(u, slot, retain);
+            continue;
+        }
+        slot = AllocSlot(u, sector);
+        if (slot < 0) {
+            break;
+        }
+        memcpy(u->stage[slot].data, (char *) req->buffer + (i * USLOSS_DISK_SECTOR_SIZE),
+               USLOSS_DISK_SECTOR_SIZE);
+        CacheInsert(u, slot, retain);
+    }
+}
+
+/*
+ * Prefetch
+ *
+ * Reads the sectors in the unit's readahead window that aren't cached into the cache, up to the
+ * end of the current track so that pending requests aren't held up for long.
+ */
+static void
+Prefetch(int unit)
+{
+    Unit    *u = &units[unit];
+    char    data[USLOSS_DISK_SECTOR_SIZE];
+    int     first, last;
+    int     rc;
+
+    LOCK(u->lock);
+    first = u->raNext;
+    last = (first / USLOSS_DISK_TRACK_SIZE + 1) * USLOSS_DISK_TRACK_SIZE;
+    if (last > u->raEnd) {
+        last = u->raEnd;
+    }
+    u->raNext = last;
+    UNLOCK(u->lock);
+
+    for (int sector = first; sector < last; sector++) {
+        int track = sector / USLOSS_DISK_TRACK_SIZE;
+        int slot;
+        int cached;
+
+        LOCK(u->lock);
+        cached = (u->stageOf[sector] >= 0);
+        UNLOCK(u->lock);
+        if (cached) {
+            continue;
+        }
+        rc = Seek(unit, track);
+        if (rc != P1_SUCCESS) {
+            break;
+        }
+        rc = DiskOp(unit, USLOSS_DISK_READ, (void *) (sector % USLOSS_DISK_TRACK_SIZE), data);
+        if (rc != P1_SUCCESS) {
+            break;
+        }
+        LOCK(u->lock);
+        if ((u->stageOf[sector] < 0) && (GetAdvice(u, -1, sector) != P2_ADVISE_DONTNEED)) {
+            slot = AllocSlot(u, sector);
+            if (slot >= 0) {
+                Retain retain = GetRetention(u, -1, sector);
+                memcpy(u->stage[slot].data, data, USLOSS_DISK_SECTOR_SIZE);
+                // a sector read ahead for a scan must survive until the scan gets to it
+                CacheInsert(u, slot, (retain == RETAIN_LOW) ? RETAIN_NORMAL : retain);
+                u->stats.readahead++;
+            }
+        }
+        UNLOCK(u->lock);
+    }
+}
+
+/*
+ * ReadAhead
+ *
+ * Asks the driver to read a range of sectors into the cache while it is idle. A range that
+ * continues the current readahead window extends it, otherwise it replaces it. Must be called
+ * with the unit's lock held.
+ */
+static void
+ReadAhead(Unit *u, int first, int end)
+{
+    int rc;
+
+    if (end > u->tracks * USLOSS_DISK_TRACK_SIZE) {
+        end = u->tracks * USLOSS_DISK_TRACK_SIZE;
+    }
+    if (first >= end) {
+        return;
+    }
+    if ((u->raNext >= u->raEnd) || (first < u->raNext) || (first > u->raEnd)) {
+        u->raNext = first;
+        u->raEnd = end;
+    } else if (end > u->raEnd) {
+        u->raEnd = end;
+    }
+    rc = P1_Signal(u->cond);
+    assert(rc == P1_SUCCESS);
+}
+
+static int
+CompareStages(const void *a, const void *b)
+{
+    return (*((Stage **) a))->sector - (*((Stage **) b))->sector;
+}
+
+/*
+ * Flush
+ *
+ * Writes the dirty sectors in the staging area to the disk in sector order. Sectors that are
+ * written again while the flush is in progress stay dirty and are written by the next flush.
+ */
+static void
+Flush(int unit)
+{
+    Unit    *u = &units[unit];
+    Stage   *batch[STAGE_SECTORS];
+    int     n = 0;
+    int     generation;
+    int     start = USLOSS_Clock();
+    int     now;
+    int     rc;
+
+    LOCK(u->lock);
+    generation = u->syncRequested;
+    u->flushWanted = FALSE;
+    u->flushing = TRUE;
+    for (int i = 0; i < STAGE_SECTORS; i++) {
+        Stage *st = &u->stage[i];
+        if (st->dirty) {
+            st->dirty = FALSE;
+            st->flushing = TRUE;
+            batch[n++] = st;
+        }
+    }
+    u->dirty -= n;
+    UNLOCK(u->lock);
+
+    qsort(batch, n, sizeof(Stage *), CompareStages);
+    for (int i = 0; i < n; i++) {
+        int sector = batch[i]->sector;
+        int track = sector / USLOSS_DISK_TRACK_SIZE;
+        rc = Seek(unit, track);
+        if (rc == P1_SUCCESS) {
+            rc = DiskOp(unit, USLOSS_DISK_WRITE, (void *) (sector % USLOSS_DISK_TRACK_SIZE),
+                        batch[i]->data);
+        }
+        if (rc != P1_SUCCESS) {
+            USLOSS_Console("Disk %d: unable to write staged sector %d.\n", unit, sector);
+        }
+    }
+
+    LOCK(u->lock);
+    for (int i = 0; i < n; i++) {
+        Stage *st = batch[i];
+        st->flushing = FALSE;
+        if (st->stale) {
+            FreeSlot(u, st - u->stage);
+        } else if (!st->dirty && Cacheable(u, -1, st->sector)) {
+            // the sector stays cached
+            CacheInsert(u, st - u->stage, GetRetention(u, -1, st->sector));
+        } else if (!st->dirty) {
+            u->stageOf[st->sector] = -1;
+            FreeSlot(u, st - u->stage);
+        }
+    }
+    now = USLOSS_Clock();
+    u->flushing = FALSE;
+    u->synced = generation;
+    u->lastFlush = now;
+    u->stats.flushes++;
+    u->stats.flushedBytes += n * USLOSS_DISK_SECTOR_SIZE;
+    u->stats.flushLatency = now - start;
+    if (u->stats.flushLatency > u->stats.maxFlushLatency) {
+        u->stats.maxFlushLatency = u->stats.flushLatency;
+    }
+    rc = P1_Broadcast(u->flushed);
+    assert(rc == P1_SUCCESS);
+    UNLOCK(u->lock);
+}
+
+/*
+ * DiskTick
+ *
+ * Clock handler that refills the token buckets of rate-limited processes and has the drivers
+ * of units in write-back mode flush their dirty sectors every FLUSH_INTERVAL microseconds.
+ */
+static void
+DiskTick(int now)
+{
+    int refilled = FALSE;
+    int rc;
+
+    LOCK(tenantLock);
+    for (int i = 0; i < P1_MAXPROC; i++) {
+        Tenant *t = &tenants[i];
+        if (t->rate > 0) {
+            t->tokens += (long long) t->rate * (now - lastRefill);
+            if (t->tokens > t->rate * TOKEN_SCALE) {
+                t->tokens = t->rate * TOKEN_SCALE;
+            }
+            refilled = TRUE;
+        }
+    }
+    lastRefill = now;
+    if (refilled) {
+        rc = P1_Broadcast(tenantCond);
+        assert(rc == P1_SUCCESS);
+    }
+    UNLOCK(tenantLock);
+
+    for (int unit = 0; unit < USLOSS_DISK_UNITS; unit++) {
+        Unit *u = &units[unit];
+        if (!u->writeBack) {
+            continue;
+        }
+        LOCK(u->lock);
+        if ((u->dirty > 0) && !u->flushWanted && ((now - u->lastFlush) >= FLUSH_INTERVAL)) {
+            u->flushWanted = TRUE;
+            rc = P1_Signal(u->cond);
+            assert(rc == P1_SUCCESS);
+        }
+        UNLOCK(u->lock);
+    }
+}
+
+/*
+ * Finish
+ *
+ * Completes a request with the return code and wakes the issuing process, or reclaims the
+ * request's descriptor if the process is no longer waiting for it. Must be called with the
+ * unit's lock held.
+ */
+static void
+Finish(Unit *u, Request *req, int rc)
+{
+    int status;
+
+    if (req->abandoned) {
+        FreeRequest(u, req);
+        return;
+    }
+    req->rc = rc;
+    req->done = TRUE;
+    status = P1_Signal(req->cond);
+    assert(status == P1_SUCCESS);
+}
+
+/*
+ * Abandon
+ *
+ * Fails the requests still queued when the drain limit passes. Must be called with the unit's
+ * lock held.
+ */
+static void
+Abandon(Unit *u)
+{
+    for (int class = 0; class < IO_CLASSES; class++) {
+        for (int op = 0; op < 2; op++) {
+            Request *req;
+            while ((req = u->deadlineQueues[class][op].head) != NULL) {
+                Dequeue(u, req);
+                u->stats.abandoned++;
+                Finish(u, req, P1_WAIT_ABORTED);
+            }
+        }
+    }
+}
+
+/*
+ * DiskDriver
+ *
+ * Kernel process that manages a disk device and services disk I/O requests from other processes.
+ * Note that it may require several disk operations to service a single I/O request. A disk
+ * operation is performed by sending a request of type USLOSS_DeviceRequest to the disk via
+ * USLOSS_DeviceOutput, then waiting for the operation to finish via P1_DeviceWait. The status
+ * returned by P1_WaitDevice will tell you if the operation was successful or not.
+ */
+static int 
+DiskDriver(void *arg) 
+{
+    int     unit = (int) arg;
+    Unit    *u = &units[unit];
+    int     rc;
+
+    StartUnit(unit);
+    while (1) {
+        Request *req;
+
+        LOCK(u->lock);
+        while ((u->pending == 0) && !u->flushWanted && !u->shutdown && 
+               (u->raNext >= u->raEnd)) {
+            rc = P1_Wait(u->cond);
+            assert(rc == P1_SUCCESS);
+        }
+        if (u->flushWanted || (u->shutdown && (u->pending == 0) && (u->dirty > 0))) {
+            // flush periodically, on request, or before exiting
+            UNLOCK(u->lock);
+            Flush(unit);
+            continue;
+        }
+        if (u->shutdown && (u->pending > 0) && 
+            ((USLOSS_Clock() - u->shutdownTime) >= DRAIN_LIMIT)) {
+            Abandon(u);
+            UNLOCK(u->lock);
+            continue;
+        }
+        if ((u->pending == 0) && !u->shutdown) {
+            // idle, read ahead
+            UNLOCK(u->lock);
+            Prefetch(unit);
+            continue;
+        }
+        if (u->pending == 0) {
+            // shutting down and nothing left to do
+            UNLOCK(u->lock);
+            break;
+        }
+        req = ChooseRequest(u);
+        UNLOCK(u->lock);
+
+        rc = DoRequest(unit, req);
+
+        // wake the waiting process
+        LOCK(u->lock);
+        if (req->cancelled && (rc == P1_WAIT_ABORTED)) {
+            u->stats.aborted++;
+        } else if (rc == P1_WAIT_ABORTED) {
+            u->stats.abandoned++;
+        }
+        if (req->op == USLOSS_DISK_WRITE) {
+            // cached copies may predate the write
+            Uncache(u, req->first, req->sectors);
+        }
+        if ((req->op == USLOSS_DISK_READ) && (rc == P1_SUCCESS) && !req->abandoned) {
+            Overlay(u, req);
+            if (req->class != IO_CLASS_PAGING) {
+                Fill(u, req);
+            }
+        }
+        Finish(u, req, rc);
+        UNLOCK(u->lock);
+    }
+    LOCK(u->lock);
+    u->running = FALSE;
+    u->stats.drainLatency = USLOSS_Clock() - u->shutdownTime;
+    rc = P1_Broadcast(u->stopped);
+    assert(rc == P1_SUCCESS);
+    UNLOCK(u->lock);
+#ifdef DEBUG
+    USLOSS_Console("DiskDriver PID %d unit %d exiting.\n", P1_GetPid(), unit);
+#endif
+    return 0;
+}
+
+/*
+ * DiskStarter
+ *
+ * Kernel process that forks the driver of each unit when GetTracks requests it, and joins the
+ * drivers it forked once P2DiskShutdown has stopped them.
+ */
+static int
+DiskStarter(void *arg)
+{
+    int     forked[USLOSS_DISK_UNITS] = {0};
+    int     drivers = 0;
+    int     pid, status;
+    int     rc;
+
+    LOCK(starterLock);
+    while (1) {
+        for (int unit = 0; unit < USLOSS_DISK_UNITS; unit++) {
+            Unit    *u = &units[unit];
+            int     start;
+
+            LOCK(u->lock);
+            start = u->started && !forked[unit];
+            UNLOCK(u->lock);
+            if (start) {
+                char name[P1_MAXNAME];
+                snprintf(name, sizeof(name), "Disk Driver %d", unit);
+                rc = P1_Fork(name, DiskDriver, (void *) unit, USLOSS_MIN_STACK*4, 1, &pid);
+                assert(rc == P1_SUCCESS);
+                forked[unit] = TRUE;
+                drivers++;
+            }
+        }
+        // drivers requested before shutdown have been forked
+        if (starterStop) {
+            break;
+        }
+        rc = P1_Wait(starterCond);
+        assert(rc == P1_SUCCESS);
+    }
+    UNLOCK(starterLock);
+    for (int i = 0; i < drivers; i++) {
+        rc = P1_Join(&pid, &status);
+        assert(rc == P1_SUCCESS);
+    }
+    return 0;
+}
+
+/*
+ * GetTenant
+ *
+ * Returns the tenant entry of a process. Must be called with tenantLock held.
+ */
+static Tenant *
+GetTenant(int pid)
+{
+    assert((pid >= 0) && (pid < P1_MAXPROC));
+    return &tenants[pid];
+}
+
+/*
+ * PriorityClass
+ *
+ * Returns the I/O priority class of a process priority.
+ */
+static IoClass
+PriorityClass(int priority)
+{
+    if (priority <= 2) {
+        return IO_CLASS_RT;
+    } else if (priority <= 4) {
+        return IO_CLASS_BE;
+    }
+    return IO_CLASS_IDLE;
+}
+
+/*
+ * ProcessClass
+ *
+ * Returns the I/O priority class of a process, from its priority or the priority it inherited
+ * through P2DiskInherit, whichever is higher.
+ */
+static IoClass
+ProcessClass(int pid)
+{
+    P1_ProcInfo info;
+    int         priority;
+    int         boost;
+    int         rc;
+
+    rc = P1_GetProcInfo(pid, &info);
+    assert(rc == P1_SUCCESS);
+    priority = info.priority;
+    LOCK(tenantLock);
+    boost = GetTenant(pid)->boost;
+    UNLOCK(tenantLock);
+    if ((boost > 0) && (boost < priority)) {
+        priority = boost;
+    }
+    return PriorityClass(priority);
+}
+
+/*
+ * GetIoClass
+ *
+ * Returns the I/O priority class of the current process.
+ */
+static IoClass
+GetIoClass(void)
+{
+    return ProcessClass(P1_GetPid());
+}
+
+/*
+ * AdvisedClass
+ *
+ * Returns the class a process's request starting at the sector is queued in given the class of
+ * the process: sequential scans yield to other requests by going one class lower. Must be
+ * called with the unit's lock held.
+ */
+static IoClass
+AdvisedClass(Unit *u, int pid, IoClass class, int first)
+{
+    if ((class != IO_CLASS_PAGING) && (class < IO_CLASS_IDLE) && 
+        (GetAdvice(u, pid, first) == P2_ADVISE_SEQUENTIAL)) {
+        class++;
+    }
+    return class;
+}
+
+/*
+ * Admit
+ *
+ * Waits until the calling process's token bucket permits it to transfer the specified number
+ * of sectors and charges the bucket. A request larger than the bucket is admitted when the
+ * bucket isn't empty and leaves it in debt. Returns the process's fair queueing weight.
+ */
+static int
+Admit(int sectors, IoClass class)
+{
+    Tenant  *t;
+    int     weight;
+    int     rc;
+
+    LOCK(tenantLock);
+    t = GetTenant(P1_GetPid());
+    if (t->rate > 0) {
+        while (t->tokens <= 0) {
+            rc = P1_Wait(tenantCond);
+            assert(rc == P1_SUCCESS);
+        }
+        t->tokens -= sectors * TOKEN_SCALE;
+    }
+    weight = (t->weight > 0) ? t->weight : classWeights[class];
+    UNLOCK(tenantLock);
+    return weight;
+}
+
+/*
+ * AllocRequest
+ *
+ * Takes a request descriptor from the unit's free list and records it in the calling process's
+ * slot. A request still in the slot was left by a previous process with this pid that died
+ * waiting for it, so it is orphaned. Waits for a descriptor if such requests have used up the
+ * pool. Must be called with the unit's lock held.
+ */
+static Request *
+AllocRequest(Unit *u, int pid)
+{
+    Request *req;
+    int     rc;
+
+    Orphan(u, pid);
+    while (u->free == NULL) {
+        rc = P1_Wait(u->freed);
+        assert(rc == P1_SUCCESS);
+    }
+    req = u->free;
+    u->free = req->links[LINK_TRACK].next;
+    req->links[LINK_TRACK].next = NULL;
+    req->done = FALSE;
+    req->cancelled = FALSE;
+    req->abandoned = FALSE;
+    req->pid = pid;
+    u->slots[pid] = req;
+    u->inUse++;
+    if (u->inUse > u->highWater) {
+        u->highWater = u->inUse;
+    }
+    return req;
+}
+
+/*
+ * FreeRequest
+ *
+ * Returns a request descriptor to the unit's free list and wakes a process waiting for one. Must
+ * be called with the unit's lock held.
+ */
+static void
+FreeRequest(Unit *u, Request *req)
+{
+    int rc;
+
+    if (u->slots[req->pid] == req) {
+        u->slots[req->pid] = NULL;
+    }
+    req->links[LINK_TRACK].next = u->free;
+    u->free = req;
+    u->inUse--;
+    rc = P1_Signal(u->freed);
+    assert(rc == P1_SUCCESS);
+}
+
+/*
+ * Orphan
+ *
+ * Abandons the outstanding request of a process that will never wait for it. A queued or
+ * completed request is reclaimed at once; one in progress is cancelled and reclaimed by the
+ * driver when it stops. Must be called with the unit's lock held.
+ */
+static void
+Orphan(Unit *u, int pid)
+{
+    Request *req = u->slots[pid];
+
+    if (req == NULL) {
+        return;
+    }
+    u->slots[pid] = NULL;
+    req->abandoned = TRUE;
+    req->cancelled = TRUE;
+    if (req->queued) {
+        Dequeue(u, req);
+        FreeRequest(u, req);
+    } else if (req->done) {
+        FreeRequest(u, req);
+    }
+}
+
+/*
+ * Submit
+ *
+ * Gives a request to the unit's device driver and waits until the request is complete.
+ */
+static int
+Submit(int unit, int op, int first, int sectors, void *buffer, IoClass class)
+{
+    Unit        *u = &units[unit];
+    Request     *req;
+    int         pid = P1_GetPid();
+    int         weight;
+    int         rc;
+
+    if (class == IO_CLASS_PAGING) {
+        weight = classWeights[class];
+    } else {
+        weight = Admit(sectors, class);
+    }
+
+    LOCK(u->lock);
+    req = AllocRequest(u, pid);
+    if (u->shutdown) {
+        // possibly while waiting for a descriptor
+        FreeRequest(u, req);
+        UNLOCK(u->lock);
+        return P1_WAIT_ABORTED;
+    }
+    req->weight = weight;
+    if ((u->vtimes[pid] - u->vtime) < 0) {
+        // an idle process doesn't accumulate credit
+        u->vtimes[pid] = u->vtime;
+    }
+    req->op = op;
+    req->first = first;
+    req->sectors = sectors;
+    req->buffer = buffer;
+    req->track = first / USLOSS_DISK_TRACK_SIZE;
+    class = AdvisedClass(u, pid, class, first);
+    req->class = class;
+    req->arrival = USLOSS_Clock();
+    req->deadline = req->arrival + deadlines[class][op == USLOSS_DISK_WRITE];
+    if (op == USLOSS_DISK_WRITE) {
+        DropStaged(u, first, sectors);
+    }
+    if (class == IO_CLASS_PAGING) {
+        u->stats.paging++;
+    }
+    Enqueue(u, req);
+    rc = P1_Signal(u->cond);
+    assert(rc == P1_SUCCESS);
+    while (!req->done) {
+        rc = P1_Wait(req->cond);
+        assert(rc == P1_SUCCESS);
+    }
+    rc = req->rc;
+    FreeRequest(u, req);
+    UNLOCK(u->lock);
+    return rc;
+}
+
 /*
- * P2DiskInit
+ * StageWrite
  *
- * Initialize the disk data structures and fork the disk drivers.
+ * Copies the data of a write into the unit's staging area. If the staging area is full the
+ * driver is asked to flush it and the caller waits for free slots.
  */
-void 
-P2DiskInit(void) 
+static int
+StageWrite(int unit, int first, int sectors, void *buffer)
 {
-    int rc;
-
-    // initialize data structures here including lock and condition variables
+    Unit    *u = &units[unit];
+    int     rc;
 
-    rc = P2_SetSyscallHandler(SYS_DISKREAD, ReadStub);
-    assert(rc == P1_SUCCESS);
+    (void) Admit(sectors, GetIoClass());
+    LOCK(u->lock);
+    if (u->shutdown) {
+        UNLOCK(u->lock);
+        return P1_WAIT_ABORTED;
+    }
+    for (int i = 0; i < sectors; i++) {
+        int     sector = first + i;
+        int     slot;
+        Stage   *st;
 
-    rc = P2_SetSyscallHandler(SYS_DISKWRITE, WriteStub);
-    assert(rc == P1_SUCCESS);
+        slot = u->stageOf[sector];
+        while (slot < 0) {
+            slot = AllocSlot(u, sector);
+            if (slot < 0) {
+                u->flushWanted = TRUE;
+                rc = P1_Signal(u->cond);
+                assert(rc == P1_SUCCESS);
+                rc = P1_Wait(u->flushed);
+                assert(rc == P1_SUCCESS);
+                slot = u->stageOf[sector];
+            }
+        }
+        st = &u->stage[slot];
+        if (st->cached) {
+            LruRemove(u, slot);
+        }
+        memcpy(st->data, (char *) buffer + (i * USLOSS_DISK_SECTOR_SIZE), USLOSS_DISK_SECTOR_SIZE);
+        if (!st->dirty) {
+            st->dirty = TRUE;
+            u->dirty++;
+        }
+    }
+    if (u->dirty * USLOSS_DISK_SECTOR_SIZE > u->stats.maxDirtyBytes) {
+        u->stats.maxDirtyBytes = u->dirty * USLOSS_DISK_SECTOR_SIZE;
+    }
+    UNLOCK(u->lock);
+    return P1_SUCCESS;
+}
 
-    rc = P2_SetSyscallHandler(SYS_DISKSIZE, SizeStub);
-    assert(rc == P1_SUCCESS);
+/*
+ * GetTracks
+ *
+ * Returns the # of tracks on the unit, having the Disk Starter fork the unit's device driver if
+ * this is the first request to the unit and waiting for the driver to determine the # of tracks
+ * if necessary. Returns P1_WAIT_ABORTED after shutdown.
+ */
+static int
+GetTracks(int unit, int *tracks)
+{
+    Unit    *u = &units[unit];
+    int     start;
+    int     rc;
 
-    for (int unit = 0; unit < USLOSS_DISK_UNITS; unit++) {
-        int pid;
-        rc = P1_Fork(MakeName("Disk Driver ", unit), DiskDriver, (void *) unit, USLOSS_MIN_STACK*4, 
-                     1, &pid);
+    LOCK(u->lock);
+    if (u->shutdown) {
+        UNLOCK(u->lock);
+        return P1_WAIT_ABORTED;
+    }
+    start = !u->started;
+    if (start) {
+        u->started = TRUE;
+        u->running = TRUE;
+        u->startTime = USLOSS_Clock();
+    }
+    UNLOCK(u->lock);
+    if (start) {
+        LOCK(starterLock);
+        rc = P1_Signal(starterCond);
+        assert(rc == P1_SUCCESS);
+        UNLOCK(starterLock);
+    }
+    LOCK(u->lock);
+    while (u->tracks < 0) {
+        rc = P1_Wait(u->ready);
         assert(rc == P1_SUCCESS);
     }
+    *tracks = u->tracks;
+    UNLOCK(u->lock);
+    return P1_SUCCESS;
 }
 
 /*
- * P2DiskShutdown
+ * CheckRange
  *
- * Stop the disk drivers.
+ * Validates a unit and a range of sectors on it.
  */
+static int
+CheckRange(int unit, int first, int sectors)
+{
+    int tracks;
+    int rc;
 
-void 
-P2DiskShutdown(void) 
+    if ((unit < 0) || (unit >= USLOSS_DISK_UNITS)) {
+        return P1_INVALID_UNIT;
+    }
+    rc = GetTracks(unit, &tracks);
+    if (rc != P1_SUCCESS) {
+        return rc;
+    }
+    if ((first < 0) || (first >= tracks * USLOSS_DISK_TRACK_SIZE)) {
+        return P2_INVALID_FIRST;
+    }
+    if ((sectors <= 0) || (first + sectors > tracks * USLOSS_DISK_TRACK_SIZE)) {
+        return P2_INVALID_SECTORS;
+    }
+    return P1_SUCCESS;
+}
+
+/*
+ * CheckRequest
+ *
+ * Validates the parameters of a read or write.
+ */
+static int
+CheckRequest(int unit, int first, int sectors, void *buffer)
 {
+    if ((unit < 0) || (unit >= USLOSS_DISK_UNITS)) {
+        return P1_INVALID_UNIT;
+    }
+    if (buffer == NULL) {
+        return P2_NULL_ADDRESS;
+    }
+    return CheckRange(unit, first, sectors);
 }
 
 /*
- * DiskDriver
+ * CacheRead
  *
- * Kernel process that manages a disk device and services disk I/O requests from other processes.
- * Note that it may require several disk operations to service a single I/O request. A disk
- * operation is performed by sending a request of type USLOSS_DeviceRequest to the disk via
- * USLOSS_DeviceOutput, then waiting for the operation to finish via P1_DeviceWait. The status
- * returned by P1_WaitDevice will tell you if the operation was successful or not.
+ * Copies the sectors of a read from the cache if they are all there. Returns TRUE if it did.
  */
-static int 
-DiskDriver(void *arg) 
+static int
+CacheRead(int unit, int first, int sectors, void *buffer)
 {
-    int unit = (int) arg;
-    /****
-    repeat
-        choose request with shortest seek from current track
-        seek to proper track if necessary
-        while request isn't complete
-             for all sectors to be read/written in current track
-                read/write sector
-             seek to next track
-        wake the waiting process
-    until P2DiskShutdown has been called
-    ****/
-    USLOSS_Console("DiskDriver PID %d unit %d exiting.\n", P1_GetPid(), unit);
-    return 0;
+    Unit    *u = &units[unit];
+    Advice  *a;
+    int     pid = P1_GetPid();
+    int     hit = TRUE;
+
+    LOCK(u->lock);
+    for (int i = 0; i < sectors; i++) {
+        if (u->stageOf[first + i] < 0) {
+            hit = FALSE;
+            break;
+        }
+    }
+    if (hit) {
+        for (int i = 0; i < sectors; i++) {
+            int slot = u->stageOf[first + i];
+            memcpy((char *) buffer + (i * USLOSS_DISK_SECTOR_SIZE), u->stage[slot].data,
+                   USLOSS_DISK_SECTOR_SIZE);
+            CacheTouch(u, slot, GetRetention(u, pid, first + i));
+        }
+        u->stats.cacheHits++;
+    } else {
+        u->stats.cacheMisses++;
+    }
+    // keep ahead of a sequential reader, within the hinted range
+    a = FindAdvice(u, pid, first + sectors - 1);
+    if ((a != NULL) && (a->advice == P2_ADVISE_SEQUENTIAL)) {
+        int end = first + sectors + READAHEAD;
+        if (end > a->first + a->sectors) {
+            end = a->first + a->sectors;
+        }
+        ReadAhead(u, first + sectors, end);
+    }
+    UNLOCK(u->lock);
+    return hit;
 }
 
 /*
@@ -98,10 +2042,11 @@ DiskDriver(void *arg)
 int 
 P2_DiskRead(int unit, int first, int sectors, void *buffer) 
 {
-    // validate parameters
-    // give request to the unit's device driver
-    // wait until device driver completes the request
-    return P1_SUCCESS;
+    int rc = CheckRequest(unit, first, sectors, buffer);
+    if ((rc == P1_SUCCESS) && !CacheRead(unit, first, sectors, buffer)) {
+        rc = Submit(unit, USLOSS_DISK_READ, first, sectors, buffer, GetIoClass());
+    }
+    return rc;
 }
 
 /*
@@ -112,9 +2057,460 @@ P2_DiskRead(int unit, int first, int sectors, void *buffer)
 int 
 P2_DiskWrite(int unit, int first, int sectors, void *buffer) 
 {
-    // validate parameters
-    // give request to the unit's device driver
-    // wait until device driver completes the request
+    int rc = CheckRequest(unit, first, sectors, buffer);
+    if (rc == P1_SUCCESS) {
+        if (units[unit].writeBack && (sectors <= STAGE_DIRECT)) {
+            rc = StageWrite(unit, first, sectors, buffer);
+        } else {
+            rc = Submit(unit, USLOSS_DISK_WRITE, first, sectors, buffer, GetIoClass());
+        }
+    }
+    return rc;
+}
+
+/*
+ * CheckBytes
+ *
+ * Validates the parameters of a byte-granular read or write.
+ */
+static int
+CheckBytes(int unit, int offset, int length, void *buffer)
+{
+    int tracks;
+    int size;
+    int rc;
+
+    if ((unit < 0) || (unit >= USLOSS_DISK_UNITS)) {
+        return P1_INVALID_UNIT;
+    }
+    if (buffer == NULL) {
+        return P2_NULL_ADDRESS;
+    }
+    rc = GetTracks(unit, &tracks);
+    if (rc != P1_SUCCESS) {
+        return rc;
+    }
+    size = tracks * USLOSS_DISK_TRACK_SIZE * USLOSS_DISK_SECTOR_SIZE;
+    if ((offset < 0) || (offset >= size)) {
+        return P2_INVALID_FIRST;
+    }
+    if ((length <= 0) || (length > size - offset)) {
+        return P2_INVALID_SECTORS;
+    }
+    return P1_SUCCESS;
+}
+
+/*
+ * Patch
+ *
+ * Replaces part of a sector with a read-modify-write. The read is served from the cache if the
+ * sector is there, and in write-back mode the write is staged. Patches to the same unit are
+ * serialized so that concurrent patches of the same sector don't undo each other.
+ */
+static int
+Patch(int unit, int sector, int skip, int length, void *data)
+{
+    Unit    *u = &units[unit];
+    char    buffer[USLOSS_DISK_SECTOR_SIZE];
+    int     rc;
+
+    LOCK(u->patchLock);
+    rc = P2_DiskRead(unit, sector, 1, buffer);
+    if (rc == P1_SUCCESS) {
+        memcpy(buffer + skip, data, length);
+        rc = P2_DiskWrite(unit, sector, 1, buffer);
+    }
+    UNLOCK(u->patchLock);
+    return rc;
+}
+
+/*
+ * P2_DiskPRead
+ *
+ * Reads length bytes from the disk starting at byte offset. Partial sectors at either end are
+ * read into a kernel buffer and copied; the whole sectors in between are read directly.
+ */
+int
+P2_DiskPRead(int unit, int offset, int length, void *buffer)
+{
+    char    *buf = (char *) buffer;
+    char    sector[USLOSS_DISK_SECTOR_SIZE];
+    int     rc = CheckBytes(unit, offset, length, buffer);
+
+    while ((rc == P1_SUCCESS) && (length > 0)) {
+        int first = offset / USLOSS_DISK_SECTOR_SIZE;
+        int skip = offset % USLOSS_DISK_SECTOR_SIZE;
+        int n;
+
+        if ((skip > 0) || (length < USLOSS_DISK_SECTOR_SIZE)) {
+            n = USLOSS_DISK_SECTOR_SIZE - skip;
+            if (n > length) {
+                n = length;
+            }
+            rc = P2_DiskRead(unit, first, 1, sector);
+            if (rc == P1_SUCCESS) {
+                memcpy(buf, sector + skip, n);
+            }
+        } else {
+            n = length - (length % USLOSS_DISK_SECTOR_SIZE);
+            rc = P2_DiskRead(unit, first, n / USLOSS_DISK_SECTOR_SIZE, buf);
+        }
+        offset += n;
+        buf += n;
+        length -= n;
+    }
+    return rc;
+}
+
+/*
+ * P2_DiskPWrite
+ *
+ * Writes length bytes to the disk starting at byte offset. Partial sectors at either end are
+ * patched with a read-modify-write; the whole sectors in between are written directly.
+ */
+int
+P2_DiskPWrite(int unit, int offset, int length, void *buffer)
+{
+    char    *buf = (char *) buffer;
+    int     rc = CheckBytes(unit, offset, length, buffer);
+
+    while ((rc == P1_SUCCESS) && (length > 0)) {
+        int first = offset / USLOSS_DISK_SECTOR_SIZE;
+        int skip = offset % USLOSS_DISK_SECTOR_SIZE;
+        int n;
+
+        if ((skip > 0) || (length < USLOSS_DISK_SECTOR_SIZE)) {
+            n = USLOSS_DISK_SECTOR_SIZE - skip;
+            if (n > length) {
+                n = length;
+            }
+            rc = Patch(unit, first, skip, n, buf);
+        } else {
+            n = length - (length % USLOSS_DISK_SECTOR_SIZE);
+            rc = P2_DiskWrite(unit, first, n / USLOSS_DISK_SECTOR_SIZE, buf);
+        }
+        offset += n;
+        buf += n;
+        length -= n;
+    }
+    return rc;
+}
+
+/*
+ * P2DiskPageIn
+ *
+ * Reads sectors for the pager. Paging requests are served ahead of all other requests.
+ */
+int
+P2DiskPageIn(int unit, int first, int sectors, void *buffer)
+{
+    int rc = CheckRequest(unit, first, sectors, buffer);
+    if (rc == P1_SUCCESS) {
+        rc = Submit(unit, USLOSS_DISK_READ, first, sectors, buffer, IO_CLASS_PAGING);
+    }
+    return rc;
+}
+
+/*
+ * P2DiskPageOut
+ *
+ * Writes sectors for the pager. The write bypasses the staging area even in write-back mode.
+ */
+int
+P2DiskPageOut(int unit, int first, int sectors, void *buffer)
+{
+    int rc = CheckRequest(unit, first, sectors, buffer);
+    if (rc == P1_SUCCESS) {
+        rc = Submit(unit, USLOSS_DISK_WRITE, first, sectors, buffer, IO_CLASS_PAGING);
+    }
+    return rc;
+}
+
+/*
+ * P2_DiskSync
+ *
+ * Waits until all sectors written to the unit in write-back mode are on the disk.
+ */
+int
+P2_DiskSync(int unit)
+{
+    Unit    *u;
+    int     generation;
+    int     rc;
+
+    if ((unit < 0) || (unit >= USLOSS_DISK_UNITS)) {
+        return P1_INVALID_UNIT;
+    }
+    u = &units[unit];
+    LOCK(u->lock);
+    if ((u->dirty > 0) || u->flushing) {
+        generation = ++u->syncRequested;
+        u->flushWanted = TRUE;
+        rc = P1_Signal(u->cond);
+        assert(rc == P1_SUCCESS);
+        while ((u->synced - generation) < 0) {
+            rc = P1_Wait(u->flushed);
+            assert(rc == P1_SUCCESS);
+        }
+    }
+    UNLOCK(u->lock);
+    return P1_SUCCESS;
+}
+
+/*
+ * P2_DiskAdvise
+ *
+ * Records how the calling process will access a range of sectors on the unit. See Advice.
+ */
+int
+P2_DiskAdvise(int unit, int first, int sectors, int advice)
+{
+    Unit    *u;
+    Advice  *a = NULL;
+    int     pid = P1_GetPid();
+    int     rc;
+
+    if ((advice < P2_ADVISE_NORMAL) || (advice > P2_ADVISE_DONTNEED)) {
+        return P2_INVALID_ARGUMENT;
+    }
+    rc = CheckRange(unit, first, sectors);
+    if (rc != P1_SUCCESS) {
+        return rc;
+    }
+    u = &units[unit];
+    LOCK(u->lock);
+    for (int i = 0; i < MAX_ADVICE; i++) {
+        Advice *b = &u->advice[i];
+        if ((b->sectors > 0) && (b->pid == pid) && (b->first >= first) && 
+            (b->first + b->sectors <= first + sectors)) {
+            // superseded
+            b->sectors = 0;
+        }
+        if ((a == NULL) || (b->sectors == 0) || 
+            ((a->sectors > 0) && ((b->seq - a->seq) < 0))) {
+            // use an empty entry or replace the oldest
+            a = b;
+        }
+    }
+    a->pid = pid;
+    a->first = first;
+    a->sectors = sectors;
+    a->advice = advice;
+    a->seq = ++u->adviceSeq;
+    if (advice == P2_ADVISE_DONTNEED) {
+        Uncache(u, first, sectors);
+    } else if (advice == P2_ADVISE_WILLNEED) {
+        ReadAhead(u, first, first + ((sectors < STAGE_SECTORS / 2) ? sectors : STAGE_SECTORS / 2));
+    }
+    UNLOCK(u->lock);
+    return P1_SUCCESS;
+}
+
+/*
+ * P2DiskSetWriteBack
+ *
+ * Enables or disables write-back mode on the unit. Disabling it writes any dirty sectors to the
+ * disk before returning.
+ */
+int
+P2DiskSetWriteBack(int unit, int enable)
+{
+    Unit *u;
+
+    if ((unit < 0) || (unit >= USLOSS_DISK_UNITS)) {
+        return P1_INVALID_UNIT;
+    }
+    u = &units[unit];
+    LOCK(u->lock);
+    u->writeBack = enable;
+    UNLOCK(u->lock);
+    return enable ? P1_SUCCESS : P2_DiskSync(unit);
+}
+
+/*
+ * P2DiskInherit
+ *
+ * Gives a process's disk requests at least the specified priority, e.g. one inherited from a
+ * process waiting on a lock it holds, until it is called again with a priority of 0. A request
+ * the process has already queued is moved to the class it would get now, whether that is higher
+ * or, when the inherited priority is lowered or cleared, lower, and given that class's deadline;
+ * paging requests are unaffected.
+ */
+int
+P2DiskInherit(int pid, int priority)
+{
+    P1_ProcInfo info;
+    IoClass     class;
+    int         rc;
+
+    if ((pid < 0) || (pid >= P1_MAXPROC) || (priority < 0)) {
+        return P2_INVALID_ARGUMENT;
+    }
+    rc = P1_GetProcInfo(pid, &info);
+    if ((rc != P1_SUCCESS) || (info.state == P1_STATE_FREE)) {
+        return P1_INVALID_PID;
+    }
+    LOCK(tenantLock);
+    GetTenant(pid)->boost = priority;
+    UNLOCK(tenantLock);
+    class = ProcessClass(pid);
+    for (int unit = 0; unit < USLOSS_DISK_UNITS; unit++) {
+        Unit    *u = &units[unit];
+        Request *req;
+        IoClass advised;
+
+        LOCK(u->lock);
+        req = u->slots[pid];
+        if ((req != NULL) && req->queued && (req->class != IO_CLASS_PAGING) &&
+            ((advised = AdvisedClass(u, pid, class, req->first)) != req->class)) {
+            Dequeue(u, req);
+            req->class = advised;
+            req->deadline = req->arrival + deadlines[advised][req->op == USLOSS_DISK_WRITE];
+            Enqueue(u, req);
+        }
+        UNLOCK(u->lock);
+    }
+    return P1_SUCCESS;
+}
+
+/*
+ * P2DiskCancel
+ *
+ * Cancels the disk requests of a process, e.g. one that another process is killing. A queued
+ * request is dropped and one in progress stops at the next track boundary, and the request fails
+ * with P1_WAIT_ABORTED. Data the process staged in write-back mode is still written. The request
+ * of a process that never gets to see the failure is orphaned when the process exits or its pid
+ * is reused.
+ */
+void
+P2DiskCancel(int pid)
+{
+    if ((pid < 0) || (pid >= P1_MAXPROC)) {
+        return;
+    }
+    for (int unit = 0; unit < USLOSS_DISK_UNITS; unit++) {
+        Unit    *u = &units[unit];
+        Request *req;
+
+        LOCK(u->lock);
+        req = u->slots[pid];
+        if ((req != NULL) && !req->done) {
+            if (req->queued) {
+                Dequeue(u, req);
+                u->stats.cancelled++;
+                Finish(u, req, P1_WAIT_ABORTED);
+            } else {
+                req->cancelled = TRUE;
+            }
+        }
+        UNLOCK(u->lock);
+    }
+}
+
+/*
+ * DiskExit
+ *
+ * Exit handler that resets the tenant entry, per-unit state and access hints of a terminating
+ * process and orphans its outstanding requests, so that a process that later gets the same pid
+ * starts afresh.
+ */
+static void
+DiskExit(int pid)
+{
+    LOCK(tenantLock);
+    memset(GetTenant(pid), 0, sizeof(Tenant));
+    UNLOCK(tenantLock);
+    for (int unit = 0; unit < USLOSS_DISK_UNITS; unit++) {
+        Unit *u = &units[unit];
+
+        LOCK(u->lock);
+        Orphan(u, pid);
+        u->vtimes[pid] = u->vtime;
+        u->ends[pid] = -1;
+        for (int i = 0; i < MAX_ADVICE; i++) {
+            if (u->advice[i].pid == pid) {
+                u->advice[i].sectors = 0;
+            }
+        }
+        UNLOCK(u->lock);
+    }
+}
+
+/*
+ * P2DiskSetFair
+ *
+ * Enables or disables fair queueing between processes on the unit.
+ */
+int
+P2DiskSetFair(int unit, int enable)
+{
+    Unit *u;
+
+    if ((unit < 0) || (unit >= USLOSS_DISK_UNITS)) {
+        return P1_INVALID_UNIT;
+    }
+    u = &units[unit];
+    LOCK(u->lock);
+    u->fair = enable;
+    UNLOCK(u->lock);
+    return P1_SUCCESS;
+}
+
+/*
+ * P2DiskSetPolicy
+ *
+ * Sets the unit's scheduling policy, one of the P2_DISK_* policies in phase2Int.h. Adaptive mode
+ * starts with shortest seek first.
+ */
+int
+P2DiskSetPolicy(int unit, int policy)
+{
+    Unit *u;
+
+    if ((unit < 0) || (unit >= USLOSS_DISK_UNITS)) {
+        return P1_INVALID_UNIT;
+    }
+    if ((policy < P2_DISK_SSTF) || (policy > P2_DISK_ADAPTIVE)) {
+        return P2_INVALID_ARGUMENT;
+    }
+    u = &units[unit];
+    LOCK(u->lock);
+    u->policy = policy;
+    u->active = (policy == P2_DISK_ADAPTIVE) ? P2_DISK_SSTF : policy;
+    u->sinceAdapt = 0;
+    UNLOCK(u->lock);
+    return P1_SUCCESS;
+}
+
+/*
+ * P2DiskSetShare
+ *
+ * Sets the fair queueing weight of a process, from 1 to FAIR_SCALE or 0 for the default of its
+ * I/O class, and the max. # of sectors per second it may transfer, 0 for no limit.
+ */
+int
+P2DiskSetShare(int pid, int weight, int sectorsPerSecond)
+{
+    P1_ProcInfo info;
+    Tenant      *t;
+    int         rc;
+
+    if ((weight < 0) || (weight > FAIR_SCALE) || (sectorsPerSecond < 0)) {
+        return P2_INVALID_ARGUMENT;
+    }
+    rc = P1_GetProcInfo(pid, &info);
+    if ((rc != P1_SUCCESS) || (info.state == P1_STATE_FREE)) {
+        return P1_INVALID_PID;
+    }
+    LOCK(tenantLock);
+    t = GetTenant(pid);
+    t->weight = weight;
+    if (t->rate != sectorsPerSecond) {
+        // start with a full bucket
+        t->rate = sectorsPerSecond;
+        t->tokens = sectorsPerSecond * TOKEN_SCALE;
+    }
+    UNLOCK(tenantLock);
     return P1_SUCCESS;
 }
 
@@ -126,10 +2522,48 @@ P2_DiskWrite(int unit, int first, int sectors, void *buffer)
 int 
 P2_DiskSize(int unit, int *sector, int *disk) 
 {
+    int tracks;
+    int rc;
+
+    if ((unit < 0) || (unit >= USLOSS_DISK_UNITS)) {
+        return P1_INVALID_UNIT;
+    }
+    if ((sector == NULL) || (disk == NULL)) {
+        return P2_NULL_ADDRESS;
+    }
+    rc = GetTracks(unit, &tracks);
+    if (rc == P1_SUCCESS) {
+        *sector = USLOSS_DISK_SECTOR_SIZE;
+        *disk = tracks * USLOSS_DISK_TRACK_SIZE;
+    }
+    return rc;
+}
+
+/*
+ * P2DiskGetStats
+ *
+ * Returns statistics about the unit.
+ */
+int
+P2DiskGetStats(int unit, P2DiskStats *stats)
+{
+    Unit *u;
 
-    // validate parameter
-    // give request to the unit's device driver
-    // wait until device driver completes the request
+    if ((unit < 0) || (unit >= USLOSS_DISK_UNITS)) {
+        return P1_INVALID_UNIT;
+    }
+    if (stats == NULL) {
+        return P2_NULL_ADDRESS;
+    }
+    u = &units[unit];
+    LOCK(u->lock);
+    *stats = u->stats;
+    stats->poolSize = POOL_SIZE;
+    stats->poolHighWater = u->highWater;
+    stats->dirtyBytes = u->dirty * USLOSS_DISK_SECTOR_SIZE;
+    stats->cached = u->cachedSlots;
+    stats->policy = u->active;
+    UNLOCK(u->lock);
     return P1_SUCCESS;
 }
 
@@ -163,4 +2597,36 @@ SizeStub(USLOSS_Sysargs *sysargs)
     sysargs->arg4 = (void *) rc;
 }
 
+static void 
+SyncStub(USLOSS_Sysargs *sysargs) 
+{
+    int     rc;
+    rc = P2_DiskSync((int) sysargs->arg1);
+    sysargs->arg4 = (void *) rc;
+}
+
+static void 
+AdviseStub(USLOSS_Sysargs *sysargs) 
+{
+    int     rc;
+    rc = P2_DiskAdvise((int) sysargs->arg4, (int) sysargs->arg3, (int) sysargs->arg2, 
+                       (int) sysargs->arg1);
+    sysargs->arg4 = (void *) rc;
+}
+
+static void 
+PReadStub(USLOSS_Sysargs *sysargs) 
+{
+    int     rc;
+    rc = P2_DiskPRead((int) sysargs->arg4, (int) sysargs->arg3, (int) sysargs->arg2, sysargs->arg1);
+    sysargs->arg4 = (void *) rc;
+}
 
+static void 
+PWriteStub(USLOSS_Sysargs *sysargs) 
+{
+    int     rc;
+    rc = P2_DiskPWrite((int) sysargs->arg4, (int) sysargs->arg3, (int) sysargs->arg2,
+                       sysargs->arg1);
+    sysargs->arg4 = (void *) rc;
+}
@@ -0,0 +1,280 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include <usloss.h>
+#include <phase1.h>
+
+#include "phase2Int.h"
+
+/*
+ * Swap area for the pager. The swap area is a range of whole tracks on one unit divided into
+ * page-sized slots. Slots are laid out in groups: a page that fits in a track is never split
+ * across tracks, so a track holds USLOSS_DISK_TRACK_SIZE / sectors-per-page slots, and a larger
+ * page starts at a track boundary. Contiguous slots are contiguous on the disk unless there is
+ * a gap at the end of a group, so a run of slots is read or written with one request, and a run
+ * within a group with one seek. P2SwapAlloc therefore prefers runs that fit in a group, then
+ * runs that start at the beginning of one.
+ */
+
+static int      swapLock;       // protects the variables below
+static int      swapUnit = -1;  // unit of the swap area, -1 if there isn't one
+static int      swapFirst;      // first sector of the swap area
+static int      pageSectors;    // # of sectors in a slot
+static int      groupSectors;   // # of sectors in a group of slots
+static int      groupSlots;     // # of slots in a group
+static int      seamless;       // groups have no gap at the end
+static int      numSlots;       // # of slots
+static char     *used;          // used[i] is TRUE if slot i is allocated
+
+#define LOCK(lid) { \
+    int _rc = P1_Lock(lid); \
+    assert(_rc == P1_SUCCESS); \
+}
+
+#define UNLOCK(lid) { \
+    int _rc = P1_Unlock(lid); \
+    assert(_rc == P1_SUCCESS); \
+}
+
+/*
+ * SlotSector
+ *
+ * Returns the first sector of a slot.
+ */
+static int
+SlotSector(int slot)
+{
+    return swapFirst + (slot / groupSlots) * groupSectors + (slot % groupSlots) * pageSectors;
+}
+
+/*
+ * IsRun
+ *
+ * Returns TRUE if the slots are all in the swap area, contiguous on the disk, and all allocated
+ * or all free depending on "allocated". Must be called with swapLock held.
+ */
+static int
+IsRun(int slot, int pages, int allocated)
+{
+    if ((slot < 0) || (pages <= 0) || (pages > numSlots - slot)) {
+        return FALSE;
+    }
+    if (!seamless && ((slot % groupSlots) + pages > groupSlots)) {
+        return FALSE;
+    }
+    for (int i = slot; i < slot + pages; i++) {
+        if (used[i] != allocated) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/*
+ * P2SwapSetup
+ *
+ * Creates the swap lock. Called by P2DiskInit, before any process can create or use the swap
+ * area.
+ */
+void
+P2SwapSetup(void)
+{
+    int rc;
+
+    rc = P1_LockCreate("Swap Lock", &swapLock);
+    assert(rc == P1_SUCCESS);
+    swapUnit = -1;
+}
+
+/*
+ * P2SwapInit
+ *
+ * Creates a swap area of the specified tracks of the unit for pages of pageSize bytes, which
+ * must be a multiple of the sector size. There can only be one swap area.
+ */
+int
+P2SwapInit(int unit, int firstTrack, int tracks, int pageSize)
+{
+    int sectorSize;
+    int diskSectors;
+    int rc;
+
+    if ((pageSize <= 0) || ((pageSize % USLOSS_DISK_SECTOR_SIZE) != 0) || (firstTrack < 0) ||
+        (tracks <= 0)) {
+        return P2_INVALID_ARGUMENT;
+    }
+    rc = P2_DiskSize(unit, &sectorSize, &diskSectors);
+    if (rc != P1_SUCCESS) {
+        return rc;
+    }
+    if ((firstTrack + tracks) * USLOSS_DISK_TRACK_SIZE > diskSectors) {
+        return P2_INVALID_ARGUMENT;
+    }
+    LOCK(swapLock);
+    if (swapUnit >= 0) {
+        UNLOCK(swapLock);
+        return P2_INVALID_ARGUMENT;
+    }
+    pageSectors = pageSize / USLOSS_DISK_SECTOR_SIZE;
+    if (pageSectors <= USLOSS_DISK_TRACK_SIZE) {
+        groupSectors = USLOSS_DISK_TRACK_SIZE;
+        groupSlots = USLOSS_DISK_TRACK_SIZE / pageSectors;
+    } else {
+        groupSectors = ((pageSectors + USLOSS_DISK_TRACK_SIZE - 1) / USLOSS_DISK_TRACK_SIZE) *
+                       USLOSS_DISK_TRACK_SIZE;
+        groupSlots = 1;
+    }
+    seamless = (groupSlots * pageSectors == groupSectors);
+    numSlots = ((tracks * USLOSS_DISK_TRACK_SIZE) / groupSectors) * groupSlots;
+    if (numSlots == 0) {
+        UNLOCK(swapLock);
+        return P2_INVALID_ARGUMENT;
+    }
+    used = calloc(numSlots, sizeof(char));
+    assert(used != NULL);
+    swapFirst = firstTrack * USLOSS_DISK_TRACK_SIZE;
+    swapUnit = unit;
+    UNLOCK(swapLock);
+    return P1_SUCCESS;
+}
+
+/*
+ * P2SwapAlloc
+ *
+ * Allocates a run of contiguous slots for the specified # of pages and returns the first.
+ * Returns P2_SWAP_FULL if there is no such run.
+ */
+int
+P2SwapAlloc(int pages, int *slot)
+{
+    int found = -1;
+
+    if (slot == NULL) {
+        return P2_NULL_ADDRESS;
+    }
+    if (pages <= 0) {
+        return P2_INVALID_ARGUMENT;
+    }
+    LOCK(swapLock);
+    if (swapUnit < 0) {
+        UNLOCK(swapLock);
+        return P2_INVALID_ARGUMENT;
+    }
+    // first a run within a group, then one that starts a group, then any run
+    for (int pass = 0; (pass < 3) && (found < 0); pass++) {
+        for (int i = 0; (i < numSlots) && (found < 0); i++) {
+            if (((pass == 0) && ((i % groupSlots) + pages > groupSlots)) ||
+                ((pass == 1) && ((i % groupSlots) != 0))) {
+                continue;
+            }
+            if (IsRun(i, pages, FALSE)) {
+                found = i;
+            }
+        }
+    }
+    if (found >= 0) {
+        memset(&used[found], TRUE, pages);
+        *slot = found;
+    }
+    UNLOCK(swapLock);
+    return (found >= 0) ? P1_SUCCESS : P2_SWAP_FULL;
+}
+
+/*
+ * P2SwapFree
+ *
+ * Frees a run of slots allocated by P2SwapAlloc, or part of one.
+ */
+int
+P2SwapFree(int slot, int pages)
+{
+    int rc = P1_SUCCESS;
+
+    LOCK(swapLock);
+    if ((swapUnit >= 0) && IsRun(slot, pages, TRUE)) {
+        memset(&used[slot], FALSE, pages);
+    } else {
+        rc = P2_INVALID_ARGUMENT;
+    }
+    UNLOCK(swapLock);
+    return rc;
+}
+
+/*
+ * Transfer
+ *
+ * Reads or writes a run of allocated slots with a single paging request.
+ */
+static int
+Transfer(int slot, int pages, void *buffer, int write)
+{
+    int valid;
+    int unit;
+    int first;
+    int sectors;
+
+    if (buffer == NULL) {
+        return P2_NULL_ADDRESS;
+    }
+    LOCK(swapLock);
+    valid = (swapUnit >= 0) && IsRun(slot, pages, TRUE);
+    unit = swapUnit;
+    first = valid ? SlotSector(slot) : -1;
+    sectors = pages * pageSectors;
+    UNLOCK(swapLock);
+    if (!valid) {
+        return P2_INVALID_ARGUMENT;
+    }
+    if (write) {
+        return P2DiskPageOut(unit, first, sectors, buffer);
+    }
+    return P2DiskPageIn(unit, first, sectors, buffer);
+}
+
+/*
+ * P2SwapRead
+ *
+ * Reads pages from a run of allocated slots into the buffer.
+ */
+int
+P2SwapRead(int slot, int pages, void *buffer)
+{
+    return Transfer(slot, pages, buffer, FALSE);
+}
+
+/*
+ * P2SwapWrite
+ *
+ * Writes pages from the buffer to a run of allocated slots. Clustering page-outs into one call
+ * costs one request and, within a group, one seek.
+ */
+int
+P2SwapWrite(int slot, int pages, void *buffer)
+{
+    return Transfer(slot, pages, buffer, TRUE);
+}
+
+/*
+ * P2SwapSector
+ *
+ * Returns the unit and first sector of a slot.
+ */
+int
+P2SwapSector(int slot, int *unit, int *sector)
+{
+    int rc = P1_SUCCESS;
+
+    if ((unit == NULL) || (sector == NULL)) {
+        return P2_NULL_ADDRESS;
+    }
+    LOCK(swapLock);
+    if ((swapUnit < 0) || (slot < 0) || (slot >= numSlots)) {
+        rc = P2_INVALID_ARGUMENT;
+    } else {
+        *unit = swapUnit;
+        *sector = SlotSector(slot);
+    }
+    UNLOCK(swapLock);
+    return rc;
+}
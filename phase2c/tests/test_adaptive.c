@@ -0,0 +1,124 @@
+/*
+ * Tests the adaptive scheduler. A single process reading random sectors one at a time should
+ * make it switch to FIFO, several processes each reading its own region of the disk in order
+ * should make it switch to the elevator, and several processes reading random sectors should
+ * make it switch to shortest seek first.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <assert.h>
+#include <libuser.h>
+#include <libdisk.h>
+
+#include "tester.h"
+#include "phase2Int.h"
+
+static int passed = FALSE;
+
+#define TRACKS 50
+#define NUMSECTORS (TRACKS * USLOSS_DISK_TRACK_SIZE)
+#define DISKUNIT 0
+#define WORKERS 4
+#define REQUESTS 64     // per phase, enough to replace the scheduler's window
+
+static int sequential;
+
+int Worker(void *arg) {
+    int id = (int) arg;
+    unsigned int state = id + 1;
+    int requests = (id < 0) ? REQUESTS : REQUESTS / WORKERS * 2;
+    char buffer[USLOSS_DISK_SECTOR_SIZE];
+    int rc;
+
+    for (int i = 0; i < requests; i++) {
+        int sector;
+        if (sequential) {
+            sector = (NUMSECTORS / WORKERS) * id + i;
+        } else {
+            sector = rand_r(&state) % NUMSECTORS;
+        }
+        rc = Sys_DiskRead(buffer, sector, 1, DISKUNIT);
+        TEST_RC(rc, P1_SUCCESS);
+    }
+    return 11;
+}
+
+static void
+Phase(int workers)
+{
+    int rc, waitPid, status, pid;
+
+    for (int i = 0; i < workers; i++) {
+        rc = P2_Spawn(MakeName("Worker", i), Worker, (void *) ((workers == 1) ? -1 : i),
+                      4*USLOSS_MIN_STACK, 3, &pid);
+        TEST_RC(rc, P1_SUCCESS);
+    }
+    for (int i = 0; i < workers; i++) {
+        rc = P2_Wait(&waitPid, &status);
+        TEST_RC(rc, P1_SUCCESS);
+        TEST(status, 11);
+    }
+}
+
+static int
+Policy(void)
+{
+    P2DiskStats stats;
+    int rc = P2DiskGetStats(DISKUNIT, &stats);
+    TEST_RC(rc, P1_SUCCESS);
+    return stats.policy;
+}
+
+int P2_Startup(void *arg)
+{
+    int rc;
+    P2DiskStats stats;
+
+    P2ClockInit();
+    P2DiskInit();
+    rc = P2DiskSetPolicy(DISKUNIT, P2_DISK_ADAPTIVE);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = P2DiskSetPolicy(DISKUNIT, 42);
+    TEST_RC(rc, P2_INVALID_ARGUMENT);
+
+    sequential = FALSE;
+    Phase(1);
+    TEST(Policy(), P2_DISK_FIFO);
+
+    sequential = TRUE;
+    Phase(WORKERS);
+    TEST(Policy(), P2_DISK_ELEVATOR);
+
+    sequential = FALSE;
+    Phase(WORKERS);
+    TEST(Policy(), P2_DISK_SSTF);
+
+    rc = P2DiskGetStats(DISKUNIT, &stats);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(stats.policySwitches >= 3, 1);
+
+    P2DiskShutdown();
+    P2ClockShutdown();
+    passed = TRUE;
+    return 0;
+}
+
+void test_setup(int argc, char **argv) {
+    int rc;
+
+    DeleteAllDisks();
+    rc = Disk_Create(NULL, DISKUNIT, TRACKS);
+    assert(rc == 0);
+}
+
+void test_cleanup(int argc, char **argv) {
+    DeleteAllDisks();
+    if (passed) {
+        PASSED_FINISH();
+    }
+}
+void finish(int argc, char **argv) {}
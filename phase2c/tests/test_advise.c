@@ -0,0 +1,168 @@
+/*
+ * Tests access hints. Reads without hints are not cached. A lookup worker that declared a small
+ * hot set of sectors P2_ADVISE_WILLNEED reads it so that it is cached, then a scan worker that
+ * declared its range P2_ADVISE_SEQUENTIAL reads the rest of the disk, which is larger than the
+ * cache. Verifies that the scan did not evict the hot set,
+ * that the driver read ahead of the scan, that every sector read has the right contents, and
+ * that P2_ADVISE_DONTNEED drops the hot set from the cache.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <assert.h>
+#include <libuser.h>
+#include <libdisk.h>
+
+#include "tester.h"
+#include "libuser2.h"
+#include "phase2Int.h"
+
+static int passed = FALSE;
+
+#define TRACKS 40
+#define NUMSECTORS (TRACKS * USLOSS_DISK_TRACK_SIZE)
+#define HOT 16
+#define DISKUNIT 0
+
+static void
+CheckSector(char *buffer, int sector)
+{
+    TEST(*((int *) buffer), sector);
+}
+
+int Init(void *arg) {
+    char buffer[USLOSS_DISK_TRACK_SIZE * USLOSS_DISK_SECTOR_SIZE];
+    int rc;
+
+    // tag each sector with its number
+    for (int track = 0; track < TRACKS; track++) {
+        for (int i = 0; i < USLOSS_DISK_TRACK_SIZE; i++) {
+            *((int *) &buffer[i * USLOSS_DISK_SECTOR_SIZE]) = track * USLOSS_DISK_TRACK_SIZE + i;
+        }
+        rc = Sys_DiskWrite(buffer, track * USLOSS_DISK_TRACK_SIZE, USLOSS_DISK_TRACK_SIZE,
+                           DISKUNIT);
+        TEST_RC(rc, P1_SUCCESS);
+    }
+    return 11;
+}
+
+int Plain(void *arg) {
+    char buffer[USLOSS_DISK_SECTOR_SIZE];
+    int rc;
+
+    for (int i = 0; i < 2 * HOT; i++) {
+        int sector = i % HOT;
+        rc = Sys_DiskRead(buffer, sector, 1, DISKUNIT);
+        TEST_RC(rc, P1_SUCCESS);
+        CheckSector(buffer, sector);
+    }
+    return 11;
+}
+
+int Lookup(void *arg) {
+    char buffer[USLOSS_DISK_SECTOR_SIZE];
+    int rc;
+
+    rc = Sys_DiskAdvise(DISKUNIT, 0, HOT, P2_ADVISE_WILLNEED);
+    TEST_RC(rc, P1_SUCCESS);
+    for (int i = 0; i < HOT; i++) {
+        int sector = (i * 7) % HOT;
+        rc = Sys_DiskRead(buffer, sector, 1, DISKUNIT);
+        TEST_RC(rc, P1_SUCCESS);
+        CheckSector(buffer, sector);
+    }
+    return 11;
+}
+
+int Scan(void *arg) {
+    char buffer[USLOSS_DISK_SECTOR_SIZE];
+    int rc;
+
+    rc = Sys_DiskAdvise(DISKUNIT, HOT, NUMSECTORS - HOT, P2_ADVISE_SEQUENTIAL);
+    TEST_RC(rc, P1_SUCCESS);
+    for (int sector = HOT; sector < NUMSECTORS; sector++) {
+        rc = Sys_DiskRead(buffer, sector, 1, DISKUNIT);
+        TEST_RC(rc, P1_SUCCESS);
+        CheckSector(buffer, sector);
+    }
+    return 11;
+}
+
+static void
+Run(char *name, int (*func)(void *))
+{
+    int rc, waitPid, status, pid;
+
+    rc = P2_Spawn(name, func, NULL, 4*USLOSS_MIN_STACK, 3, &pid);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = P2_Wait(&waitPid, &status);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(waitPid, pid);
+    TEST(status, 11);
+}
+
+int P2_Startup(void *arg)
+{
+    int rc;
+    P2DiskStats before, after;
+
+    P2ClockInit();
+    P2DiskInit();
+
+    Run("Init", Init);
+    Run("Plain", Plain);
+    rc = P2DiskGetStats(DISKUNIT, &before);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(before.cacheHits, 0);
+    TEST(before.cached, 0);
+
+    Run("Lookup", Lookup);
+    Run("Scan", Scan);
+    rc = P2DiskGetStats(DISKUNIT, &before);
+    TEST_RC(rc, P1_SUCCESS);
+    USLOSS_Console("hits %d misses %d readahead %d cached %d\n", before.cacheHits,
+                   before.cacheMisses, before.readahead, before.cached);
+    TEST(before.readahead > 0, 1);
+
+    // the hot set survived the scan
+    Run("Lookup", Lookup);
+    rc = P2DiskGetStats(DISKUNIT, &after);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(after.cacheHits - before.cacheHits, HOT);
+    TEST(after.cacheMisses, before.cacheMisses);
+
+    rc = P2_DiskAdvise(DISKUNIT, 0, HOT, P2_ADVISE_DONTNEED);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = P2DiskGetStats(DISKUNIT, &before);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(before.cached, after.cached - HOT);
+
+    rc = P2_DiskAdvise(DISKUNIT, 0, HOT, 42);
+    TEST_RC(rc, P2_INVALID_ARGUMENT);
+    rc = P2_DiskAdvise(DISKUNIT, NUMSECTORS, 1, P2_ADVISE_RANDOM);
+    TEST_RC(rc, P2_INVALID_FIRST);
+
+    P2DiskShutdown();
+    P2ClockShutdown();
+    passed = TRUE;
+    return 0;
+}
+
+void test_setup(int argc, char **argv) {
+    int rc;
+
+    DeleteAllDisks();
+    rc = Disk_Create(NULL, DISKUNIT, TRACKS);
+    assert(rc == 0);
+}
+
+void test_cleanup(int argc, char **argv) {
+    DeleteAllDisks();
+    if (passed) {
+        PASSED_FINISH();
+    }
+}
+void finish(int argc, char **argv) {}
@@ -0,0 +1,121 @@
+/*
+ * Tests byte-granular reads and writes. Workers concurrently write interleaved 100-byte records,
+ * several to a sector, then read their own records back. Then a write that is unaligned at both
+ * ends and spans several sectors is read back both byte-wise and sector-wise.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <assert.h>
+#include <libuser.h>
+#include <libdisk.h>
+
+#include "tester.h"
+#include "libuser2.h"
+#include "phase2Int.h"
+
+static int passed = FALSE;
+
+#define TRACKS 10
+#define DISKUNIT 0
+#define WORKERS 3
+#define RECORD 100
+#define RECORDS 60
+#define SPAN_OFFSET (RECORDS * RECORD + 37)
+#define SPAN_LENGTH (3 * USLOSS_DISK_SECTOR_SIZE + 200)
+
+int Worker(void *arg) {
+    int id = (int) arg;
+    char record[RECORD];
+    int rc;
+
+    for (int i = id; i < RECORDS; i += WORKERS) {
+        memset(record, i, sizeof(record));
+        rc = Sys_DiskPWrite(record, i * RECORD, RECORD, DISKUNIT);
+        TEST_RC(rc, P1_SUCCESS);
+    }
+    for (int i = id; i < RECORDS; i += WORKERS) {
+        rc = Sys_DiskPRead(record, i * RECORD, RECORD, DISKUNIT);
+        TEST_RC(rc, P1_SUCCESS);
+        for (int j = 0; j < RECORD; j++) {
+            TEST(record[j], i);
+        }
+    }
+    return 11;
+}
+
+int Span(void *arg) {
+    static char data[SPAN_LENGTH];
+    static char check[SPAN_LENGTH];
+    static char sectors[5 * USLOSS_DISK_SECTOR_SIZE];
+    int first = SPAN_OFFSET / USLOSS_DISK_SECTOR_SIZE;
+    int rc;
+
+    for (int i = 0; i < SPAN_LENGTH; i++) {
+        data[i] = i % 251;
+    }
+    rc = Sys_DiskPWrite(data, SPAN_OFFSET, SPAN_LENGTH, DISKUNIT);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_DiskPRead(check, SPAN_OFFSET, SPAN_LENGTH, DISKUNIT);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(memcmp(data, check, SPAN_LENGTH), 0);
+
+    rc = Sys_DiskRead(sectors, first, 5, DISKUNIT);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(memcmp(data, sectors + (SPAN_OFFSET % USLOSS_DISK_SECTOR_SIZE), SPAN_LENGTH), 0);
+    // the bytes before the span are untouched
+    TEST(sectors[(SPAN_OFFSET % USLOSS_DISK_SECTOR_SIZE) - 1], 0);
+    TEST(sectors[(RECORDS * RECORD - 1) % USLOSS_DISK_SECTOR_SIZE], RECORDS - 1);
+
+    rc = Sys_DiskPWrite(data, SPAN_OFFSET, 0, DISKUNIT);
+    TEST_RC(rc, P2_INVALID_SECTORS);
+    rc = Sys_DiskPRead(data, TRACKS * USLOSS_DISK_TRACK_SIZE * USLOSS_DISK_SECTOR_SIZE, 1,
+                       DISKUNIT);
+    TEST_RC(rc, P2_INVALID_FIRST);
+    return 11;
+}
+
+int P2_Startup(void *arg)
+{
+    int rc, waitPid, status, pid;
+
+    P2ClockInit();
+    P2DiskInit();
+    for (int i = 0; i < WORKERS; i++) {
+        rc = P2_Spawn(MakeName("Worker", i), Worker, (void *) i, 4*USLOSS_MIN_STACK, 3, &pid);
+        TEST_RC(rc, P1_SUCCESS);
+    }
+    for (int i = 0; i < WORKERS; i++) {
+        rc = P2_Wait(&waitPid, &status);
+        TEST_RC(rc, P1_SUCCESS);
+        TEST(status, 11);
+    }
+    rc = P2_Spawn("Span", Span, NULL, 4*USLOSS_MIN_STACK, 3, &pid);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = P2_Wait(&waitPid, &status);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(status, 11);
+    P2DiskShutdown();
+    P2ClockShutdown();
+    passed = TRUE;
+    return 0;
+}
+
+void test_setup(int argc, char **argv) {
+    int rc;
+
+    DeleteAllDisks();
+    rc = Disk_Create(NULL, DISKUNIT, TRACKS);
+    assert(rc == 0);
+}
+
+void test_cleanup(int argc, char **argv) {
+    DeleteAllDisks();
+    if (passed) {
+        PASSED_FINISH();
+    }
+}
+void finish(int argc, char **argv) {}
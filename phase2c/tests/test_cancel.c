@@ -0,0 +1,124 @@
+/*
+ * Tests cancelling the disk requests of a process that is being killed. Long writes many tracks
+ * and Victim queues a write behind it. The Controller cancels Victim's request with
+ * P2DiskCancel, as killing it would, and then Long's. Victim's request is dropped without
+ * reaching the disk, Long's stops at the next track boundary, and both fail with
+ * P1_WAIT_ABORTED because they are still waiting.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <assert.h>
+#include <libuser.h>
+#include <libdisk.h>
+
+#include "tester.h"
+#include "phase2Int.h"
+
+static int passed = FALSE;
+
+#define UNIT 0
+#define TRACKS 20
+#define LONG_TRACKS 10
+#define VICTIM_SECTOR ((TRACKS * USLOSS_DISK_TRACK_SIZE) - 1)
+
+static char longBuffer[LONG_TRACKS * USLOSS_DISK_TRACK_SIZE * USLOSS_DISK_SECTOR_SIZE];
+
+int Long(void *arg)
+{
+    int rc;
+
+    memset(longBuffer, 'l', sizeof(longBuffer));
+    rc = P2_DiskWrite(UNIT, 0, LONG_TRACKS * USLOSS_DISK_TRACK_SIZE, longBuffer);
+    TEST_RC(rc, P1_WAIT_ABORTED);
+    return 50;
+}
+
+int Victim(void *arg)
+{
+    char buffer[USLOSS_DISK_SECTOR_SIZE];
+    int rc;
+
+    memset(buffer, 'v', sizeof(buffer));
+    rc = P2_DiskWrite(UNIT, VICTIM_SECTOR, 1, buffer);
+    TEST_RC(rc, P1_WAIT_ABORTED);
+    return 51;
+}
+
+int Controller(void *arg)
+{
+    char buffer[USLOSS_DISK_SECTOR_SIZE];
+    char zeros[USLOSS_DISK_SECTOR_SIZE];
+    P2DiskStats stats;
+    int rc, status;
+    int longPid, victimPid, pid;
+
+    // the workers have a higher priority so they run until their requests block them
+    rc = P1_Fork("Long", Long, NULL, 4*USLOSS_MIN_STACK, 3, &longPid);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = P1_Fork("Victim", Victim, NULL, 4*USLOSS_MIN_STACK, 3, &victimPid);
+    TEST_RC(rc, P1_SUCCESS);
+
+    P2DiskCancel(victimPid);
+    rc = P1_Join(&pid, &status);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(pid, victimPid);
+    TEST(status, 51);
+
+    P2DiskCancel(longPid);
+    rc = P1_Join(&pid, &status);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(pid, longPid);
+    TEST(status, 50);
+
+    rc = P2DiskGetStats(UNIT, &stats);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(stats.cancelled, 1);
+    TEST(stats.aborted, 1);
+
+    memset(zeros, 0, sizeof(zeros));
+    rc = P2_DiskRead(UNIT, VICTIM_SECTOR, 1, buffer);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(memcmp(buffer, zeros, sizeof(buffer)), 0);
+    rc = P2_DiskRead(UNIT, (LONG_TRACKS * USLOSS_DISK_TRACK_SIZE) - 1, 1, buffer);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(memcmp(buffer, zeros, sizeof(buffer)), 0);
+    passed = TRUE;
+    return 11;
+}
+
+int P2_Startup(void *arg)
+{
+    int rc, pid, status;
+
+    P2ClockInit();
+    P2DiskInit();
+    rc = P1_Fork("Controller", Controller, NULL, 4*USLOSS_MIN_STACK, 4, &pid);
+    TEST(rc, P1_SUCCESS);
+    rc = P1_Join(&pid, &status);
+    TEST(rc, P1_SUCCESS);
+    TEST(status, 11);
+    P2DiskShutdown();
+    P2ClockShutdown();
+    return 0;
+}
+
+void test_setup(int argc, char **argv) {
+    int rc;
+
+    DeleteAllDisks();
+    rc = Disk_Create(NULL, UNIT, TRACKS);
+    assert(rc == 0);
+}
+
+void test_cleanup(int argc, char **argv) {
+    DeleteAllDisks();
+    if (passed) {
+        PASSED_FINISH();
+    }
+}
+
+void finish(int argc, char **argv) {}
@@ -0,0 +1,142 @@
+/*
+ * Tests that shortest seek first does not starve a far request. Several low-priority Streamers
+ * repeatedly write sectors on the first few tracks of the disk, so that there is always a request
+ * close to the disk head. Once the stream is established a high-priority Reader reads a sector
+ * on the last track. Its deadline should expire and cause the disk driver to serve it long before
+ * the Streamers are done.
+ *
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <assert.h>
+#include <libuser.h>
+#include <libdisk.h>
+
+#include "tester.h"
+#include "phase2Int.h"
+
+static int passed = FALSE;
+
+#define UNIT 0
+#define TRACKS 100
+#define NUM_STREAMERS 3
+#define NUM_WRITES 200  // # of writes per Streamer
+#define WARMUP 10       // # of writes completed before the Reader starts
+
+#define LOCK(lid) { \
+    int _rc = P1_Lock(lid); \
+    assert(_rc == P1_SUCCESS); \
+}
+
+#define UNLOCK(lid) { \
+    int _rc = P1_Unlock(lid); \
+    assert(_rc == P1_SUCCESS); \
+}
+
+static int finished = 0;        // # of writes completed by the Streamers
+static int lock;                // lock for finished
+static int cond;                // signaled when a write completes
+
+int Streamer(void *arg) 
+{
+    int id = (int) arg;
+    char buffer[USLOSS_DISK_SECTOR_SIZE];
+    memset(buffer, id, sizeof(buffer));
+
+    for (int i = 0; i < NUM_WRITES; i++) {
+        int first = (id * USLOSS_DISK_TRACK_SIZE) + (i % USLOSS_DISK_TRACK_SIZE);
+        int rc = P2_DiskWrite(UNIT, first, 1, buffer);
+        TEST_RC(rc, P1_SUCCESS);
+        LOCK(lock);
+        finished++;
+        rc = P1_Signal(cond);
+        assert(rc == P1_SUCCESS);
+        UNLOCK(lock);
+    }
+    return 50;
+}
+
+int Reader(void *arg)
+{
+    char buffer[USLOSS_DISK_SECTOR_SIZE];
+    int rc, count;
+
+    LOCK(lock);
+    while (finished < WARMUP) {
+        rc = P1_Wait(cond);
+        assert(rc == P1_SUCCESS);
+    }
+    UNLOCK(lock);
+
+    rc = P2_DiskRead(UNIT, (TRACKS * USLOSS_DISK_TRACK_SIZE) - 1, 1, buffer);
+    TEST_RC(rc, P1_SUCCESS);
+
+    LOCK(lock);
+    count = finished;
+    UNLOCK(lock);
+    USLOSS_Console("Reader finished after %d of %d writes.\n", count, 
+                   NUM_STREAMERS * NUM_WRITES);
+    TEST(count < NUM_STREAMERS * NUM_WRITES, 1);
+    return 51;
+}
+
+int Controller(void *arg) {
+
+    int rc;
+    int pid;
+    int status;
+
+    for (int i = 0; i < NUM_STREAMERS; i++) {
+        rc = P1_Fork(MakeName("Streamer", i), Streamer, (void *) i, 4*USLOSS_MIN_STACK, 4, &pid);
+        TEST_RC(rc, P1_SUCCESS);
+    }
+    rc = P1_Fork("Reader", Reader, NULL, 4*USLOSS_MIN_STACK, 2, &pid);
+    TEST_RC(rc, P1_SUCCESS);
+    for (int i = 0; i < NUM_STREAMERS + 1; i++) {
+        rc = P1_Join(&pid, &status);
+        TEST_RC(rc, P1_SUCCESS);
+        TEST((status == 50) || (status == 51), 1);
+    }
+    passed = TRUE;
+    return 11;
+}
+
+int P2_Startup(void *arg)
+{
+    int rc, pid, status;
+
+    P2ClockInit();
+    P2DiskInit();
+    rc = P1_LockCreate("Streamer Lock", &lock);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = P1_CondCreate("Streamer Cond", lock, &cond);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = P1_Fork("Controller", Controller, NULL, 4*USLOSS_MIN_STACK, 4, &pid);
+    TEST(rc, P1_SUCCESS);
+    rc = P1_Join(&pid, &status);
+    TEST(rc, P1_SUCCESS);
+    TEST(status, 11);
+    P2DiskShutdown();
+    P2ClockShutdown();
+    return 0;
+}
+
+void test_setup(int argc, char **argv) {
+    int rc;
+
+    DeleteAllDisks();
+    rc = Disk_Create(NULL, UNIT, TRACKS);
+    assert(rc == 0);
+}
+
+void test_cleanup(int argc, char **argv) {
+    DeleteAllDisks();
+    if (passed) {
+        PASSED_FINISH();
+    }
+}
+void finish(int argc, char **argv) {}
@@ -0,0 +1,164 @@
+/*
+ * Tests fair queueing and throttling. Several Near workers repeatedly write sectors on the first
+ * track of the disk and a single Far worker repeatedly writes a sector on the last track. With
+ * fair queueing enabled the Far worker should get roughly its share of the disk rather than
+ * being served only when its deadline expires. Then a Throttled worker limited to RATE sectors
+ * per second writes THROTTLED_WRITES sectors and checks that it took long enough.
+ *
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <assert.h>
+#include <libuser.h>
+#include <libdisk.h>
+
+#include "tester.h"
+#include "phase2Int.h"
+
+static int passed = FALSE;
+
+#define UNIT 0
+#define TRACKS 100
+#define NUM_NEAR 4
+#define NUM_WRITES 200          // # of writes per Near worker
+#define RATE 50                 // sectors per second for the Throttled worker
+#define THROTTLED_WRITES 150
+
+#define LOCK(lid) { \
+    int _rc = P1_Lock(lid); \
+    assert(_rc == P1_SUCCESS); \
+}
+
+#define UNLOCK(lid) { \
+    int _rc = P1_Unlock(lid); \
+    assert(_rc == P1_SUCCESS); \
+}
+
+static int nearDone = 0;        // # of Near workers that have finished
+static int farWrites = 0;       // # of writes completed by the Far worker
+static int farAtNearDone = -1;  // farWrites when the last Near worker finished
+static int lock;                // lock for above variables
+
+int Near(void *arg) 
+{
+    int id = (int) arg;
+    char buffer[USLOSS_DISK_SECTOR_SIZE];
+    memset(buffer, id, sizeof(buffer));
+
+    for (int i = 0; i < NUM_WRITES; i++) {
+        int rc = P2_DiskWrite(UNIT, id, 1, buffer);
+        TEST_RC(rc, P1_SUCCESS);
+    }
+    LOCK(lock);
+    if (++nearDone == NUM_NEAR) {
+        farAtNearDone = farWrites;
+    }
+    UNLOCK(lock);
+    return 50;
+}
+
+int Far(void *arg)
+{
+    char buffer[USLOSS_DISK_SECTOR_SIZE];
+    int done = FALSE;
+
+    memset(buffer, 0xFA, sizeof(buffer));
+    while (!done) {
+        int rc = P2_DiskWrite(UNIT, (TRACKS * USLOSS_DISK_TRACK_SIZE) - 1, 1, buffer);
+        TEST_RC(rc, P1_SUCCESS);
+        LOCK(lock);
+        farWrites++;
+        done = (nearDone == NUM_NEAR);
+        UNLOCK(lock);
+    }
+    return 51;
+}
+
+int Throttled(void *arg)
+{
+    char buffer[USLOSS_DISK_SECTOR_SIZE];
+    int start, elapsed, rc;
+
+    rc = P2DiskSetShare(P1_GetPid(), 0, RATE);
+    TEST_RC(rc, P1_SUCCESS);
+    memset(buffer, 0x77, sizeof(buffer));
+    start = USLOSS_Clock();
+    for (int i = 0; i < THROTTLED_WRITES; i++) {
+        rc = P2_DiskWrite(UNIT, i, 1, buffer);
+        TEST_RC(rc, P1_SUCCESS);
+    }
+    elapsed = USLOSS_Clock() - start;
+    USLOSS_Console("Throttled: %d writes in %d us.\n", THROTTLED_WRITES, elapsed);
+    // the bucket starts full, the rest must wait for tokens
+    TEST(elapsed >= ((THROTTLED_WRITES - RATE) * 1000000LL / RATE) * 3 / 4, 1);
+    return 52;
+}
+
+int Controller(void *arg) {
+
+    int rc;
+    int pid;
+    int status;
+
+    for (int i = 0; i < NUM_NEAR; i++) {
+        rc = P1_Fork(MakeName("Near", i), Near, (void *) i, 4*USLOSS_MIN_STACK, 3, &pid);
+        TEST_RC(rc, P1_SUCCESS);
+    }
+    rc = P1_Fork("Far", Far, NULL, 4*USLOSS_MIN_STACK, 3, &pid);
+    TEST_RC(rc, P1_SUCCESS);
+    for (int i = 0; i < NUM_NEAR + 1; i++) {
+        rc = P1_Join(&pid, &status);
+        TEST_RC(rc, P1_SUCCESS);
+    }
+    USLOSS_Console("Far worker wrote %d sectors while %d Near workers wrote %d each.\n",
+                   farAtNearDone, NUM_NEAR, NUM_WRITES);
+    TEST(farAtNearDone >= NUM_WRITES / 4, 1);
+
+    rc = P1_Fork("Throttled", Throttled, NULL, 4*USLOSS_MIN_STACK, 3, &pid);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = P1_Join(&pid, &status);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(status, 52);
+    passed = TRUE;
+    return 11;
+}
+
+int P2_Startup(void *arg)
+{
+    int rc, pid, status;
+
+    P2ClockInit();
+    P2DiskInit();
+    rc = P2DiskSetFair(UNIT, TRUE);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = P1_LockCreate("Fair Lock", &lock);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = P1_Fork("Controller", Controller, NULL, 4*USLOSS_MIN_STACK, 4, &pid);
+    TEST(rc, P1_SUCCESS);
+    rc = P1_Join(&pid, &status);
+    TEST(rc, P1_SUCCESS);
+    TEST(status, 11);
+    P2DiskShutdown();
+    P2ClockShutdown();
+    return 0;
+}
+
+void test_setup(int argc, char **argv) {
+    int rc;
+
+    DeleteAllDisks();
+    rc = Disk_Create(NULL, UNIT, TRACKS);
+    assert(rc == 0);
+}
+
+void test_cleanup(int argc, char **argv) {
+    DeleteAllDisks();
+    if (passed) {
+        PASSED_FINISH();
+    }
+}
+void finish(int argc, char **argv) {}
@@ -0,0 +1,114 @@
+/*
+ * Tests lazy driver startup and draining on shutdown. Verifies that P2DiskInit doesn't fork any
+ * drivers, that a request to unit 0 forks only its driver, that queued requests are served
+ * before the driver exits, that the driver has been joined after shutdown, and that requests
+ * after shutdown fail.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <assert.h>
+#include <libuser.h>
+#include <libdisk.h>
+
+#include "tester.h"
+#include "phase2Int.h"
+
+static int passed = FALSE;
+
+#define TRACKS 10
+#define DISKUNIT 0
+#define WORKERS 4
+
+/*
+ * Drivers
+ *
+ * Returns the # of driver processes for the unit that haven't been joined.
+ */
+static int
+Drivers(int unit)
+{
+    char        name[P1_MAXNAME];
+    P1_ProcInfo info;
+    int         count = 0;
+
+    snprintf(name, sizeof(name), "Disk Driver %d", unit);
+    for (int pid = 0; pid < P1_MAXPROC; pid++) {
+        if ((P1_GetProcInfo(pid, &info) == P1_SUCCESS) && (strcmp(info.name, name) == 0) &&
+            (info.state != P1_STATE_FREE)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+int Worker(void *arg) {
+    int id = (int) arg;
+    char buffer[USLOSS_DISK_SECTOR_SIZE];
+    int rc;
+
+    memset(buffer, id, sizeof(buffer));
+    rc = Sys_DiskWrite(buffer, id * USLOSS_DISK_TRACK_SIZE, 1, DISKUNIT);
+    TEST_RC(rc, P1_SUCCESS);
+    return 11;
+}
+
+int P2_Startup(void *arg)
+{
+    int rc, waitPid, status, pid;
+    char buffer[USLOSS_DISK_SECTOR_SIZE];
+    P2DiskStats stats;
+
+    P2ClockInit();
+    P2DiskInit();
+    TEST(Drivers(0), 0);
+    TEST(Drivers(1), 0);
+
+    for (int i = 0; i < WORKERS; i++) {
+        rc = P2_Spawn(MakeName("Worker", i), Worker, (void *) i, 4*USLOSS_MIN_STACK, 3, &pid);
+        TEST_RC(rc, P1_SUCCESS);
+    }
+    for (int i = 0; i < WORKERS; i++) {
+        rc = P2_Wait(&waitPid, &status);
+        TEST_RC(rc, P1_SUCCESS);
+        TEST(status, 11);
+    }
+    TEST(Drivers(DISKUNIT), 1);
+    TEST(Drivers(1), 0);
+
+    P2DiskShutdown();
+    TEST(Drivers(DISKUNIT), 0);
+    rc = P2DiskGetStats(DISKUNIT, &stats);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(stats.abandoned, 0);
+    TEST(stats.startLatency > 0, 1);
+
+    rc = P2_DiskRead(DISKUNIT, 0, 1, buffer);
+    TEST_RC(rc, P1_WAIT_ABORTED);
+    rc = P2_DiskRead(1, 0, 1, buffer);
+    TEST_RC(rc, P1_WAIT_ABORTED);
+    TEST(Drivers(1), 0);
+
+    P2ClockShutdown();
+    passed = TRUE;
+    return 0;
+}
+
+void test_setup(int argc, char **argv) {
+    int rc;
+
+    DeleteAllDisks();
+    rc = Disk_Create(NULL, DISKUNIT, TRACKS);
+    assert(rc == 0);
+}
+
+void test_cleanup(int argc, char **argv) {
+    DeleteAllDisks();
+    if (passed) {
+        PASSED_FINISH();
+    }
+}
+void finish(int argc, char **argv) {}
@@ -0,0 +1,112 @@
+/*
+ * Tests the swap area. Uses three-sector pages so that a track holds five slots with a one
+ * sector gap. Verifies that runs of slots are allocated within a track when possible, that
+ * pages written to the swap area can be read back and are where the slots say they are, and
+ * that the transfers are counted as paging requests.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <assert.h>
+#include <libuser.h>
+#include <libdisk.h>
+
+#include "tester.h"
+#include "phase2Int.h"
+
+static int passed = FALSE;
+
+#define TRACKS 10
+#define DISKUNIT 0
+#define SWAP_TRACK 2
+#define SWAP_TRACKS 4
+#define PAGE_SECTORS 3
+#define PAGE_SIZE (PAGE_SECTORS * USLOSS_DISK_SECTOR_SIZE)
+
+int P2_Startup(void *arg)
+{
+    int rc, slot, unit, sector;
+    static char pages[3 * PAGE_SIZE];
+    static char check[3 * PAGE_SIZE];
+    P2DiskStats stats;
+
+    P2ClockInit();
+    P2DiskInit();
+
+    rc = P2SwapInit(DISKUNIT, SWAP_TRACK, SWAP_TRACKS, PAGE_SIZE + 1);
+    TEST_RC(rc, P2_INVALID_ARGUMENT);
+    rc = P2SwapInit(DISKUNIT, SWAP_TRACK, TRACKS, PAGE_SIZE);
+    TEST_RC(rc, P2_INVALID_ARGUMENT);
+    rc = P2SwapInit(DISKUNIT, SWAP_TRACK, SWAP_TRACKS, PAGE_SIZE);
+    TEST_RC(rc, P1_SUCCESS);
+
+    rc = P2SwapAlloc(3, &slot);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(slot, 0);
+    // doesn't fit in the rest of the first track
+    rc = P2SwapAlloc(3, &slot);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(slot, 5);
+    rc = P2SwapAlloc(2, &slot);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(slot, 3);
+    // can't be contiguous because of the gaps
+    rc = P2SwapAlloc(6, &slot);
+    TEST_RC(rc, P2_SWAP_FULL);
+
+    rc = P2SwapSector(5, &unit, &sector);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(unit, DISKUNIT);
+    TEST(sector, (SWAP_TRACK + 1) * USLOSS_DISK_TRACK_SIZE);
+
+    for (int i = 0; i < sizeof(pages); i++) {
+        pages[i] = i % 253;
+    }
+    rc = P2SwapWrite(5, 3, pages);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = P2SwapRead(5, 3, check);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(memcmp(pages, check, sizeof(pages)), 0);
+    memset(check, 0, sizeof(check));
+    rc = P2_DiskRead(DISKUNIT, sector, 3 * PAGE_SECTORS, check);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(memcmp(pages, check, sizeof(pages)), 0);
+
+    rc = P2DiskGetStats(DISKUNIT, &stats);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(stats.paging, 2);
+
+    rc = P2SwapFree(5, 3);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = P2SwapFree(5, 3);
+    TEST_RC(rc, P2_INVALID_ARGUMENT);
+    rc = P2SwapRead(5, 1, check);
+    TEST_RC(rc, P2_INVALID_ARGUMENT);
+    rc = P2SwapAlloc(5, &slot);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(slot, 5);
+
+    P2DiskShutdown();
+    P2ClockShutdown();
+    passed = TRUE;
+    return 0;
+}
+
+void test_setup(int argc, char **argv) {
+    int rc;
+
+    DeleteAllDisks();
+    rc = Disk_Create(NULL, DISKUNIT, TRACKS);
+    assert(rc == 0);
+}
+
+void test_cleanup(int argc, char **argv) {
+    DeleteAllDisks();
+    if (passed) {
+        PASSED_FINISH();
+    }
+}
+void finish(int argc, char **argv) {}
@@ -0,0 +1,119 @@
+/*
+ * Tests write-back mode. Two workers write alternating sectors of disk 0 one sector at a time,
+ * read them back before they have necessarily reached the disk, and then sync the disk. 
+ * Verifies that the data reached the disk file and that the flush statistics add up.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <assert.h>
+#include <libuser.h>
+#include <libdisk.h>
+
+#include "tester.h"
+#include "libuser2.h"
+#include "phase2Int.h"
+
+static int passed = FALSE;
+
+#define TRACKS 10
+#define NUMSECTORS (TRACKS * USLOSS_DISK_TRACK_SIZE)
+#define DISKUNIT 0
+
+int Worker(void *arg) {
+    int id = (int) arg;
+    char buffers[2][USLOSS_DISK_SECTOR_SIZE];
+    int rc;
+
+    memset(buffers[0], 0xF0 + id, sizeof(buffers[0]));
+
+    // write alternating sectors
+    for (int i = id; i < NUMSECTORS; i += 2) {
+        rc = Sys_DiskWrite(buffers[0], i, 1, DISKUNIT); 
+        TEST_RC(rc, P1_SUCCESS);
+    }
+
+    // reads must see the staged data
+    for (int i = id; i < NUMSECTORS; i += 2) {
+        memset(buffers[1], 0, sizeof(buffers[1]));
+        rc = Sys_DiskRead(buffers[1], i, 1, DISKUNIT); 
+        TEST_RC(rc, P1_SUCCESS);
+        TEST(memcmp(buffers[0], buffers[1], sizeof(buffers[0])), 0);
+    }
+    rc = Sys_DiskSync(DISKUNIT);
+    TEST_RC(rc, P1_SUCCESS);
+    return 11;
+}
+
+int P2_Startup(void *arg)
+{
+    int rc, waitPid, status, pid;
+    P2DiskStats stats;
+
+    P2ClockInit();
+    P2DiskInit();
+    rc = P2DiskSetWriteBack(DISKUNIT, TRUE);
+    TEST_RC(rc, P1_SUCCESS);
+    for (int i = 0; i < 2; i++) {
+        rc = P2_Spawn(MakeName("Worker", i), Worker, (void *) i, 4*USLOSS_MIN_STACK, 3, &pid);
+        TEST_RC(rc, P1_SUCCESS);
+    }
+    for (int i = 0; i < 2; i++) {
+        rc = P2_Wait(&waitPid, &status);
+        TEST_RC(rc, P1_SUCCESS);
+        TEST(status, 11);
+    }
+    rc = P2DiskGetStats(DISKUNIT, &stats);
+    TEST_RC(rc, P1_SUCCESS);
+    USLOSS_Console("flushes %d flushed %d bytes max dirty %d bytes max latency %d us\n",
+                   stats.flushes, stats.flushedBytes, stats.maxDirtyBytes, stats.maxFlushLatency);
+    TEST(stats.dirtyBytes, 0);
+    TEST(stats.flushes > 0, 1);
+    TEST(stats.flushedBytes >= NUMSECTORS * USLOSS_DISK_SECTOR_SIZE, 1);
+    rc = P2DiskSetWriteBack(DISKUNIT, FALSE);
+    TEST_RC(rc, P1_SUCCESS);
+    P2DiskShutdown();
+    P2ClockShutdown();
+    passed = TRUE;
+    return 0;
+}
+
+void test_setup(int argc, char **argv) {
+    int rc;
+
+    DeleteAllDisks();
+    rc = Disk_Create(NULL, DISKUNIT, TRACKS);
+    assert(rc == 0);
+}
+
+void test_cleanup(int argc, char **argv) {
+    char buffer[USLOSS_DISK_SECTOR_SIZE];
+    char expected[USLOSS_DISK_SECTOR_SIZE];
+
+    // Verify the sectors reached the disk file.
+    int fd = OpenDisk(DISKUNIT);
+    if (fd < 0) {
+        perror("Unable to open disk file");
+        exit(1);
+    }
+    for (int i = 0; i < NUMSECTORS; i++) {
+        int n = read(fd, buffer, sizeof(buffer));
+        assert(n == sizeof(buffer));
+        memset(expected, 0xF0 + (i % 2), sizeof(expected));
+        if (memcmp(buffer, expected, sizeof(buffer)) != 0) {
+            USLOSS_Console("Sector %d not written.\n", i);
+            passed = FALSE;
+            break;
+        }
+    }
+    close(fd);
+    DeleteAllDisks();
+    if (passed) {
+        PASSED_FINISH();
+    }
+}
+void finish(int argc, char **argv) {}
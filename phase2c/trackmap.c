@@ -0,0 +1,134 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "trackmap.h"
+
+#define BITS        (8 * sizeof(unsigned long))
+#define WORD(t)     ((t) / BITS)
+#define BIT(t)      (1UL << ((t) % BITS))
+
+/*
+ * TrackMapInit
+ *
+ * Initializes an empty map for a disk with the specified number of tracks. Returns 0 on success,
+ * -1 if memory could not be allocated.
+ */
+int
+TrackMapInit(TrackMap *map, int tracks)
+{
+    map->tracks = tracks;
+    map->words = (tracks + BITS - 1) / BITS;
+    map->bits = calloc((map->words > 0) ? map->words : 1, sizeof(unsigned long));
+    return (map->bits == NULL) ? -1 : 0;
+}
+
+/*
+ * TrackMapFree
+ *
+ * Frees the memory used by the map.
+ */
+void
+TrackMapFree(TrackMap *map)
+{
+    free(map->bits);
+    memset(map, 0, sizeof(*map));
+}
+
+void
+TrackMapSet(TrackMap *map, int track)
+{
+    map->bits[WORD(track)] |= BIT(track);
+}
+
+void
+TrackMapClear(TrackMap *map, int track)
+{
+    map->bits[WORD(track)] &= ~BIT(track);
+}
+
+/*
+ * TrackMapNext
+ *
+ * Returns the lowest non-empty track in [from, to], or -1 if there isn't one.
+ */
+int
+TrackMapNext(TrackMap *map, int from, int to)
+{
+    unsigned long   word;
+    int             w;
+
+    if (from < 0) {
+        from = 0;
+    }
+    if (to >= map->tracks) {
+        to = map->tracks - 1;
+    }
+    if (from > to) {
+        return -1;
+    }
+    w = WORD(from);
+    word = map->bits[w] & (~0UL << (from % BITS));
+    while (word == 0) {
+        w++;
+        if (w * BITS > to) {
+            return -1;
+        }
+        word = map->bits[w];
+    }
+    from = (w * BITS) + __builtin_ctzl(word);
+    return (from <= to) ? from : -1;
+}
+
+/*
+ * TrackMapPrev
+ *
+ * Returns the highest non-empty track in [to, from], or -1 if there isn't one.
+ */
+int
+TrackMapPrev(TrackMap *map, int from, int to)
+{
+    unsigned long   word;
+    int             shift;
+    int             w;
+
+    if (from >= map->tracks) {
+        from = map->tracks - 1;
+    }
+    if (to < 0) {
+        to = 0;
+    }
+    if (from < to) {
+        return -1;
+    }
+    w = WORD(from);
+    shift = from % BITS;
+    word = map->bits[w] & ((shift == BITS - 1) ? ~0UL : (BIT(shift) << 1) - 1);
+    while (word == 0) {
+        if (w * BITS <= to) {
+            return -1;
+        }
+        w--;
+        word = map->bits[w];
+    }
+    from = (w * BITS) + (BITS - 1 - __builtin_clzl(word));
+    return (from >= to) ? from : -1;
+}
+
+/*
+ * TrackMapNearest
+ *
+ * Returns the non-empty track nearest the specified track, the lower one if two are equally
+ * near, or -1 if the map is empty. The downward search stops at the distance of the upward one.
+ */
+int
+TrackMapNearest(TrackMap *map, int track)
+{
+    int up = TrackMapNext(map, track, map->tracks - 1);
+    int down;
+
+    if (up == track) {
+        return up;
+    }
+    down = TrackMapPrev(map, track - 1, (up < 0) ? 0 : track - (up - track));
+    return (down < 0) ? up : down;
+}
@@ -0,0 +1,26 @@
+/*
+ * trackmap.h
+ *
+ * Bitmap of the tracks of a disk that have pending requests. Searches proceed a word at a time
+ * using find-first-set, so the cost of finding the non-empty track nearest the disk head depends
+ * on the distance to that track and not on the number of pending requests.
+ */
+
+#ifndef _TRACKMAP_H
+#define _TRACKMAP_H
+
+typedef struct TrackMap {
+    int             tracks;     // # of tracks
+    int             words;      // # of words in bits
+    unsigned long   *bits;      // bit i is set if track i has pending requests
+} TrackMap;
+
+int     TrackMapInit(TrackMap *map, int tracks);
+void    TrackMapFree(TrackMap *map);
+void    TrackMapSet(TrackMap *map, int track);
+void    TrackMapClear(TrackMap *map, int track);
+int     TrackMapNext(TrackMap *map, int from, int to);
+int     TrackMapPrev(TrackMap *map, int from, int to);
+int     TrackMapNearest(TrackMap *map, int track);
+
+#endif
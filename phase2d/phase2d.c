@@ -1,6 +1,6 @@
-
 #include <string.h>
 #include <stdlib.h>
+#include <stdio.h>
 #include <usloss.h>
 #include <phase1.h>
 #include <assert.h>
@@ -9,19 +9,1873 @@
 
 #include "phase2Int.h"
 
+/*
+ * User-level locks and condition variables. They are implemented here rather than with the
+ * Phase 1 primitives so that an uncontended lock can be acquired and released without a system
+ * call. The state of each lock is in its word in P2_LockWords, which processes can read and
+ * update directly with atomic instructions (see Sys_LockAcquireFast in libuser2.h). The word of
+ * a held lock has the holder's pid, so the kernel knows the owner of every lock however it was
+ * acquired. A process only traps into the kernel if the lock is contended; the kernel then
+ * queues it on the lock and sets P2_LOCK_WAITERS in the word, so the holder traps when it
+ * releases the lock and hands it off to the first waiter.
+ *
+ * A lock acquired through the kernel always has P2_LOCK_WAITERS set, so that it is also released
+ * through the kernel and its hold time can be measured.
+ *
+ * Signaling a condition variable moves its waiters directly to the queue of its lock, which the
+ * signaler holds, so they don't wake up just to block again.
+ *
+ * The owner of a lock inherits the highest priority of the processes waiting for it, and so on
+ * through a chain of owners waiting for other locks. Phase 1 can't change the priority a process
+ * is scheduled at, so the inherited priority is applied to the owner's disk requests, including
+ * one it is already blocked on; holding a lock across disk I/O is the usual cause of long waits.
+ *
+ * WaitEvents lets a process wait for a condition variable, a timeout, and its children at once.
+ * The first event to happen records itself in the process's Proc and wakes it; the others see
+ * that an event was recorded and leave it alone.
+ *
+ * All kernel state is protected by syncLock. A process blocks on its own condition variable in
+ * procs, so that it can be woken up individually.
+ */
+
+typedef struct Queue {
+    int     head;       // first process, -1 if empty
+    int     tail;       // last process
+} Queue;
+
+typedef struct Proc {
+    int     waiting;    // TRUE while the process is blocked
+    int     cond;       // Phase 1 condition variable the process blocks on
+    int     next;       // next process in the queue the process is on
+    int     write;      // TRUE if waiting to write-acquire a reader-writer lock
+    int     count;      // # of units waiting to be taken from a semaphore
+    int     waitStart;  // time the process started waiting on a condition variable
+    int     signaled;   // time the process was signaled
+    int     blockedOn;  // lock the process is waiting for, -1 if none
+    int     boost;      // priority inherited from waiters on its locks, 0 if none
+    int     contended;  // first lock it holds that has waiters, -1 if none
+    void    *buffer;    // message buffer of a process waiting on a mailbox
+    int     size;       // size of the message or buffer
+    int     eventCond;  // condition variable a process in WaitEvents waits on, -1 if none
+    int     deadline;   // time a process in WaitEvents times out, -1 if none
+    int     children;   // TRUE if a process in WaitEvents waits for a child to terminate
+    int     event;      // event that ended WaitEvents, 0 until one has
+} Proc;
+
+typedef struct Lock {
+    int     inUse;
+    char    name[P1_MAXNAME+1];
+    Queue   waiters;    // processes waiting to acquire the lock
+    int     holdStart;  // time the holder acquired the lock, -1 if without a system call
+    int     listedBy;   // process whose contended list the lock is on, -1 if none
+    int     nextContended;  // next lock on that list
+    P2_LockStats stats; // contention statistics, except for acquires without a system call
+} Lock;
+
+typedef struct Cond {
+    int     inUse;
+    char    name[P1_MAXNAME+1];
+    int     lid;        // lock associated with the condition variable
+    Queue   waiters;    // processes waiting on the condition variable
+    P2_LockStats stats; // contention statistics
+} Cond;
+
+/*
+ * Reader-writer locks. Readers share the lock and writers hold it exclusively. Processes that
+ * can't acquire the lock wait in arrival order, and a reader can't acquire a lock that has
+ * waiters even if other readers hold it, so a stream of readers can't starve a writer. When a
+ * writer releases the lock, or the last reader does, it is handed off to the first waiter if it
+ * is a writer, else to the readers at the head of the queue.
+ */
+#define MAX_RWLOCKS     100
+
+typedef struct RwLock {
+    int     inUse;
+    char    name[P1_MAXNAME+1];
+    int     writer;             // pid of the writer holding the lock, -1 if none
+    int     numReaders;         // # of readers holding the lock
+    char    readers[P1_MAXPROC];// TRUE if the process holds the lock for reading
+    Queue   waiters;            // processes waiting to acquire the lock
+} RwLock;
+
+/*
+ * Counting semaphores. A process that takes more units than are available waits in arrival
+ * order, and a process can't take units while others are waiting, so large requests aren't
+ * starved by small ones. Sys_SemV wakes as many waiters at the head of the queue as the
+ * units allow in a single call.
+ */
+#define MAX_SEMS        200
+
+typedef struct Sem {
+    int     inUse;
+    char    name[P1_MAXNAME+1];
+    int     value;              // # of available units
+    Queue   waiters;            // processes waiting to take units
+} Sem;
+
+/*
+ * Barriers. A barrier for N processes blocks each process that reaches it until the Nth one
+ * does, which wakes all of them in a single pass and resets the barrier for the next round.
+ */
+#define MAX_BARRIERS    100
+
+typedef struct Barrier {
+    int     inUse;
+    char    name[P1_MAXNAME+1];
+    int     count;              // # of processes that synchronize at the barrier
+    int     arrived;            // # of processes waiting in the current round
+    Queue   waiters;            // processes waiting in the current round
+} Barrier;
+
+/*
+ * Mailboxes. A mailbox holds up to a fixed number of messages of up to a fixed size in a ring of
+ * slots. A message sent while a receiver is waiting is copied directly into the receiver's
+ * buffer without going through a slot, and when a receiver frees a slot the first waiting
+ * sender's message is copied into it, so each message is copied at most twice and a waiting
+ * process never has to run to complete a transfer. A mailbox with no slots passes messages
+ * directly from senders to receivers.
+ */
+#define MAX_MAILBOXES   100
+
+typedef struct Mailbox {
+    int     inUse;
+    char    name[P1_MAXNAME+1];
+    int     numSlots;           // max. # of messages held
+    int     maxSize;            // max. size of a message
+    char    *data;              // numSlots slots of maxSize bytes
+    int     *sizes;             // size of the message in each slot
+    int     head;               // slot of the oldest message
+    int     count;              // # of messages held
+    Queue   senders;            // processes waiting for a free slot
+    Queue   receivers;          // processes waiting for a message
+} Mailbox;
+
+/*
+ * Hash tables that map the names of the objects of each kind to their ids, so that processes can
+ * look up a lock or condition variable by name and creating an object doesn't have to compare its
+ * name with every other. Each bucket is a chain of ids linked through next.
+ */
+#define NAME_BUCKETS    256     // must be a power of two
+#define MAX_OF(a, b)    (((a) > (b)) ? (a) : (b))
+#define NAME_IDS        MAX_OF(MAX_OF(MAX_OF(P1_MAXLOCKS, P1_MAXCONDS), MAX_OF(MAX_RWLOCKS, \
+                            MAX_SEMS)), MAX_OF(MAX_BARRIERS, MAX_MAILBOXES))
+
+typedef struct Names {
+    int     buckets[NAME_BUCKETS];  // first id in each bucket, -1 if empty
+    int     next[NAME_IDS];         // next id in the same bucket, -1 if last
+    char    *names[NAME_IDS];       // name of each id in the table
+} Names;
+
+volatile int    P2_LockWords[P1_MAXLOCKS];  // state of each lock, P2_LOCK_INVALID if unused
+volatile int    P2_LockFastAcquires[P1_MAXLOCKS];
+
+static int      syncLock;                   // protects the variables below
+static Proc     procs[P1_MAXPROC];
+static Lock     locks[P1_MAXLOCKS];
+static Cond     conds[P1_MAXCONDS];
+static Names    lockNames;
+static Names    condNames;
+static RwLock   rwlocks[MAX_RWLOCKS];
+static Sem      sems[MAX_SEMS];
+static Barrier  barriers[MAX_BARRIERS];
+static Mailbox  mailboxes[MAX_MAILBOXES];
+static Names    rwlockNames;
+static Names    semNames;
+static Names    barrierNames;
+static Names    mailboxNames;
+
+static void     LockCreateStub(USLOSS_Sysargs *sysargs);
+static void     LockStatsStub(USLOSS_Sysargs *sysargs);
+static void     LockLookupStub(USLOSS_Sysargs *sysargs);
+static void     WaitEventsStub(USLOSS_Sysargs *sysargs);
+static void     LockFreeStub(USLOSS_Sysargs *sysargs);
+static void     LockAcquireStub(USLOSS_Sysargs *sysargs);
+static void     LockReleaseStub(USLOSS_Sysargs *sysargs);
+static void     LockNameStub(USLOSS_Sysargs *sysargs);
+static void     CondCreateStub(USLOSS_Sysargs *sysargs);
+static void     CondFreeStub(USLOSS_Sysargs *sysargs);
+static void     CondWaitStub(USLOSS_Sysargs *sysargs);
+static void     CondSignalStub(USLOSS_Sysargs *sysargs);
+static void     CondBroadcastStub(USLOSS_Sysargs *sysargs);
+static void     CondNameStub(USLOSS_Sysargs *sysargs);
+static void     RwLockCreateStub(USLOSS_Sysargs *sysargs);
+static void     RwLockFreeStub(USLOSS_Sysargs *sysargs);
+static void     RwLockAcquireStub(USLOSS_Sysargs *sysargs);
+static void     RwLockReleaseStub(USLOSS_Sysargs *sysargs);
+static void     SemCreateStub(USLOSS_Sysargs *sysargs);
+static void     SemFreeStub(USLOSS_Sysargs *sysargs);
+static void     SemPStub(USLOSS_Sysargs *sysargs);
+static void     SemVStub(USLOSS_Sysargs *sysargs);
+static void     BarrierCreateStub(USLOSS_Sysargs *sysargs);
+static void     BarrierFreeStub(USLOSS_Sysargs *sysargs);
+static void     BarrierWaitStub(USLOSS_Sysargs *sysargs);
+static void     MailboxCreateStub(USLOSS_Sysargs *sysargs);
+static void     MailboxFreeStub(USLOSS_Sysargs *sysargs);
+static void     MailboxSendStub(USLOSS_Sysargs *sysargs);
+static void     MailboxReceiveStub(USLOSS_Sysargs *sysargs);
+
+#define LOCK(lid) { \
+    int _rc = P1_Lock(lid); \
+    assert(_rc == P1_SUCCESS); \
+}
+
+#define UNLOCK(lid) { \
+    int _rc = P1_Unlock(lid); \
+    assert(_rc == P1_SUCCESS); \
+}
+
+/*
+ * CompareAndSwap
+ *
+ * Atomically sets the word to "new" if it is "old". Returns TRUE if it did.
+ */
+static int
+CompareAndSwap(volatile int *word, int old, int new)
+{
+    return __atomic_compare_exchange_n(word, &old, new, FALSE, __ATOMIC_ACQ_REL,
+                                       __ATOMIC_ACQUIRE);
+}
+
+/*
+ * Holder
+ *
+ * Returns the pid of the process holding the lock, -1 if it is free or doesn't exist.
+ */
+static int
+Holder(int lid)
+{
+    int word = P2_LockWords[lid];
+
+    return ((word == P2_LOCK_FREE) || (word == P2_LOCK_INVALID)) ? -1 : P2_LOCK_HOLDER(word);
+}
+
+/*
+ * Enqueue
+ *
+ * Adds the process to the tail of the queue.
+ */
+static void
+Enqueue(Queue *queue, int pid)
+{
+    procs[pid].next = -1;
+    if (queue->head == -1) {
+        queue->head = pid;
+    } else {
+        procs[queue->tail].next = pid;
+    }
+    queue->tail = pid;
+}
+
+/*
+ * Dequeue
+ *
+ * Removes the process at the head of the queue and returns it, -1 if the queue is empty.
+ */
+static int
+Dequeue(Queue *queue)
+{
+    int pid = queue->head;
+
+    if (pid != -1) {
+        queue->head = procs[pid].next;
+    }
+    return pid;
+}
+
+/*
+ * Block
+ *
+ * Blocks the current process until another process calls Wakeup on it. Must be called with
+ * syncLock held; it is released while the process is blocked.
+ */
+static void
+Block(int pid)
+{
+    int rc;
+
+    procs[pid].waiting = TRUE;
+    while (procs[pid].waiting) {
+        rc = P1_Wait(procs[pid].cond);
+        assert(rc == P1_SUCCESS);
+    }
+}
+
+/*
+ * Wakeup
+ *
+ * Makes a process blocked in Block runnable. Must be called with syncLock held.
+ */
+static void
+Wakeup(int pid)
+{
+    int rc;
+
+    procs[pid].waiting = FALSE;
+    rc = P1_Signal(procs[pid].cond);
+    assert(rc == P1_SUCCESS);
+}
+
+/*
+ * CheckName
+ *
+ * Returns an error code if the name can't be used for an object.
+ */
+static int
+CheckName(char *name)
+{
+    if (name == NULL) {
+        return P1_NAME_IS_NULL;
+    }
+    if (strlen(name) > P1_MAXNAME) {
+        return P1_NAME_TOO_LONG;
+    }
+    return P1_SUCCESS;
+}
+
+/*
+ * Remove
+ *
+ * Removes the process from the queue, if it is on it.
+ */
+static void
+Remove(Queue *queue, int pid)
+{
+    int prev = -1;
+
+    for (int cur = queue->head; cur != -1; prev = cur, cur = procs[cur].next) {
+        if (cur == pid) {
+            if (prev == -1) {
+                queue->head = procs[pid].next;
+            } else {
+                procs[prev].next = procs[pid].next;
+            }
+            if (queue->tail == pid) {
+                queue->tail = prev;
+            }
+            break;
+        }
+    }
+}
+
+/*
+ * Hash
+ *
+ * Returns the bucket of a name (FNV-1a).
+ */
+static int
+Hash(char *name)
+{
+    unsigned int hash = 2166136261u;
+
+    for (; *name != '\0'; name++) {
+        hash = (hash ^ (unsigned char) *name) * 16777619u;
+    }
+    return hash & (NAME_BUCKETS - 1);
+}
+
+/*
+ * NamesInit
+ *
+ * Empties a name table.
+ */
+static void
+NamesInit(Names *table)
+{
+    for (int i = 0; i < NAME_BUCKETS; i++) {
+        table->buckets[i] = -1;
+    }
+}
+
+/*
+ * NamesFind
+ *
+ * Returns the id with the name, -1 if there isn't one. Must be called with syncLock held.
+ */
+static int
+NamesFind(Names *table, char *name)
+{
+    int id;
+
+    for (id = table->buckets[Hash(name)]; id != -1; id = table->next[id]) {
+        if (strcmp(table->names[id], name) == 0) {
+            break;
+        }
+    }
+    return id;
+}
+
+/*
+ * NamesAdd
+ *
+ * Adds an id to a name table. The name must stay valid until the id is removed. Must be called
+ * with syncLock held.
+ */
+static void
+NamesAdd(Names *table, int id, char *name)
+{
+    int bucket = Hash(name);
+
+    table->names[id] = name;
+    table->next[id] = table->buckets[bucket];
+    table->buckets[bucket] = id;
+}
+
+/*
+ * NamesRemove
+ *
+ * Removes an id from a name table. Must be called with syncLock held.
+ */
+static void
+NamesRemove(Names *table, int id)
+{
+    int *link = &table->buckets[Hash(table->names[id])];
+
+    while (*link != id) {
+        assert(*link != -1);
+        link = &table->next[*link];
+    }
+    *link = table->next[id];
+}
+
+/*
+ * CheckNewName
+ *
+ * Returns an error code if the name can't be used for a new object whose names are in the table.
+ * Must be called with syncLock held.
+ */
+static int
+CheckNewName(Names *table, char *name)
+{
+    int rc = CheckName(name);
+
+    if ((rc == P1_SUCCESS) && (NamesFind(table, name) != -1)) {
+        rc = P1_DUPLICATE_NAME;
+    }
+    return rc;
+}
+
+/*
+ * AddTime
+ *
+ * Adds a wait or hold time to a total and its maximum. Returns TRUE if it is the new maximum,
+ * or ties it.
+ */
+static int
+AddTime(int *total, int *max, int time)
+{
+    *total += time;
+    if (time >= *max) {
+        *max = time;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/*
+ * Priority
+ *
+ * Returns the priority of a process, or the priority it inherited if that is higher. Must be
+ * called with syncLock held.
+ */
+static int
+Priority(int pid)
+{
+    P1_ProcInfo info;
+    int         rc;
+
+    rc = P1_GetProcInfo(pid, &info);
+    assert(rc == P1_SUCCESS);
+    if ((procs[pid].boost > 0) && (procs[pid].boost < info.priority)) {
+        return procs[pid].boost;
+    }
+    return info.priority;
+}
+
+/*
+ * WaitersPriority
+ *
+ * Returns the highest priority of the processes waiting for the lock, 0 if there are none. Must
+ * be called with syncLock held.
+ */
+static int
+WaitersPriority(int lid)
+{
+    int priority = 0;
+
+    for (int pid = locks[lid].waiters.head; pid != -1; pid = procs[pid].next) {
+        int p = Priority(pid);
+        if ((priority == 0) || (p < priority)) {
+            priority = p;
+        }
+    }
+    return priority;
+}
+
+/*
+ * Inherit
+ *
+ * Passes a waiter's priority to the owner of the lock, and on to the owner of the lock that
+ * owner is waiting for, until an owner isn't waiting for a lock or already has at least that
+ * priority. Must be called with syncLock held.
+ */
+static void
+Inherit(int lid, int priority)
+{
+    int owner;
+    int rc;
+
+    for (int i = 0; (lid != -1) && (priority > 0) && (i < P1_MAXPROC); i++) {
+        owner = Holder(lid);
+        if ((owner == -1) || (Priority(owner) <= priority)) {
+            break;
+        }
+        procs[owner].boost = priority;
+        rc = P2DiskInherit(owner, priority);
+        assert(rc == P1_SUCCESS);
+        lid = procs[owner].blockedOn;
+    }
+}
+
+/*
+ * Contend
+ *
+ * Puts a lock that has waiters on its holder's list of contended locks, if it isn't on it
+ * already. Must be called with syncLock held.
+ */
+static void
+Contend(int lid)
+{
+    int holder = Holder(lid);
+
+    if (locks[lid].listedBy == -1) {
+        assert(holder != -1);
+        locks[lid].listedBy = holder;
+        locks[lid].nextContended = procs[holder].contended;
+        procs[holder].contended = lid;
+    }
+}
+
+/*
+ * Uncontend
+ *
+ * Takes a lock off the list of contended locks it is on, if any. Must be called with syncLock
+ * held.
+ */
+static void
+Uncontend(int lid)
+{
+    int *link;
+
+    if (locks[lid].listedBy != -1) {
+        link = &procs[locks[lid].listedBy].contended;
+        while (*link != lid) {
+            assert(*link != -1);
+            link = &locks[*link].nextContended;
+        }
+        *link = locks[lid].nextContended;
+        locks[lid].listedBy = -1;
+    }
+}
+
+/*
+ * Disinherit
+ *
+ * Recomputes the inherited priority of a process that released a lock from the waiters of the
+ * contended locks it still holds. Must be called with syncLock held.
+ */
+static void
+Disinherit(int pid)
+{
+    int priority = 0;
+    int rc;
+
+    if (procs[pid].boost == 0) {
+        return;
+    }
+    for (int lid = procs[pid].contended; lid != -1; lid = locks[lid].nextContended) {
+        int p = WaitersPriority(lid);
+        if ((p > 0) && ((priority == 0) || (p < priority))) {
+            priority = p;
+        }
+    }
+    procs[pid].boost = priority;
+    rc = P2DiskInherit(pid, priority);
+    assert(rc == P1_SUCCESS);
+}
+
+/*
+ * Acquire
+ *
+ * Acquires the lock for the current process through the kernel, blocking until the holder
+ * hands it off if it is held. Must be called with syncLock held.
+ */
+static int
+Acquire(int lid)
+{
+    int     pid = P1_GetPid();
+    Lock    *lock = &locks[lid];
+    int     start = USLOSS_Clock();
+    int     waited = FALSE;
+    int     word;
+
+    if (lock->inUse && (Holder(lid) == pid)) {
+        return P1_LOCK_HELD;
+    }
+    while (Holder(lid) != pid) {
+        if (!lock->inUse) {
+            return P1_INVALID_LOCK;
+        }
+        word = P2_LockWords[lid];
+        if (word == P2_LOCK_FREE) {
+            CompareAndSwap(&P2_LockWords[lid], word, P2_LOCK_WORD(pid) | P2_LOCK_WAITERS);
+        } else if ((word & P2_LOCK_WAITERS) ||
+                   CompareAndSwap(&P2_LockWords[lid], word, word | P2_LOCK_WAITERS)) {
+            // the holder will trap when it releases the lock and hand it off
+            Enqueue(&lock->waiters, pid);
+            Contend(lid);
+            procs[pid].blockedOn = lid;
+            Inherit(lid, Priority(pid));
+            Block(pid);
+            procs[pid].blockedOn = -1;
+            waited = TRUE;
+        }
+    }
+    lock->holdStart = USLOSS_Clock();
+    lock->stats.acquires++;
+    if (waited) {
+        lock->stats.contended++;
+        AddTime(&lock->stats.totalWait, &lock->stats.maxWait, lock->holdStart - start);
+    }
+    return P1_SUCCESS;
+}
+
+/*
+ * Release
+ *
+ * Releases the lock held by the current process and hands it off to the first waiter, if any.
+ * Must be called with syncLock held.
+ */
+static int
+Release(int lid)
+{
+    int     pid = P1_GetPid();
+    Lock    *lock = &locks[lid];
+    int     next;
+
+    if (!lock->inUse) {
+        return P1_INVALID_LOCK;
+    }
+    if (Holder(lid) != pid) {
+        return P1_LOCK_NOT_HELD;
+    }
+    if ((lock->holdStart != -1) &&
+        AddTime(&lock->stats.totalHold, &lock->stats.maxHold, USLOSS_Clock() - lock->holdStart)) {
+        lock->stats.maxHolder = pid;
+    }
+    lock->holdStart = -1;
+    Uncontend(lid);
+    next = Dequeue(&lock->waiters);
+    if (next == -1) {
+        __atomic_store_n(&P2_LockWords[lid], P2_LOCK_FREE, __ATOMIC_RELEASE);
+    } else {
+        __atomic_store_n(&P2_LockWords[lid], P2_LOCK_WORD(next) | P2_LOCK_WAITERS,
+                         __ATOMIC_RELEASE);
+        if (lock->waiters.head != -1) {
+            Contend(lid);
+        }
+        Wakeup(next);
+        Inherit(lid, WaitersPriority(lid));
+    }
+    Disinherit(pid);
+    return P1_SUCCESS;
+}
+
+/*
+ * Holds
+ *
+ * Returns TRUE if the current process holds the lock, however it acquired it.
+ */
+static int
+Holds(int lid)
+{
+    return Holder(lid) == P1_GetPid();
+}
+
+static int
+LockCreate(char *name, int *lid)
+{
+    int rc;
+    int slot = -1;
+
+    LOCK(syncLock);
+    rc = CheckNewName(&lockNames, name);
+    for (int i = 0; (rc == P1_SUCCESS) && (slot == -1) && (i < P1_MAXLOCKS); i++) {
+        if (!locks[i].inUse) {
+            slot = i;
+        }
+    }
+    if ((rc == P1_SUCCESS) && (slot == -1)) {
+        rc = P1_TOO_MANY_LOCKS;
+    }
+    if (rc == P1_SUCCESS) {
+        Lock *lock = &locks[slot];
+        lock->inUse = TRUE;
+        snprintf(lock->name, sizeof(lock->name), "%s", name);
+        NamesAdd(&lockNames, slot, lock->name);
+        lock->waiters.head = -1;
+        lock->holdStart = -1;
+        lock->listedBy = -1;
+        memset(&lock->stats, 0, sizeof(lock->stats));
+        lock->stats.maxHolder = -1;
+        P2_LockFastAcquires[slot] = 0;
+        __atomic_store_n(&P2_LockWords[slot], P2_LOCK_FREE, __ATOMIC_RELEASE);
+        *lid = slot;
+    }
+    UNLOCK(syncLock);
+    return rc;
+}
+
+static int
+LockFree(int lid)
+{
+    int rc = P1_SUCCESS;
+
+    if ((lid < 0) || (lid >= P1_MAXLOCKS)) {
+        return P1_INVALID_LOCK;
+    }
+    LOCK(syncLock);
+    if (!locks[lid].inUse) {
+        rc = P1_INVALID_LOCK;
+    } else if (locks[lid].waiters.head != -1) {
+        rc = P1_BLOCKED_PROCESSES;
+    } else if (!CompareAndSwap(&P2_LockWords[lid], P2_LOCK_FREE, P2_LOCK_INVALID)) {
+        rc = P1_LOCK_HELD;
+    } else {
+        NamesRemove(&lockNames, lid);
+        locks[lid].inUse = FALSE;
+    }
+    UNLOCK(syncLock);
+    return rc;
+}
+
+static int
+LockAcquire(int lid)
+{
+    int rc;
+
+    if ((lid < 0) || (lid >= P1_MAXLOCKS)) {
+        return P1_INVALID_LOCK;
+    }
+    LOCK(syncLock);
+    rc = Acquire(lid);
+    UNLOCK(syncLock);
+    return rc;
+}
+
+static int
+LockRelease(int lid)
+{
+    int rc;
+
+    if ((lid < 0) || (lid >= P1_MAXLOCKS)) {
+        return P1_INVALID_LOCK;
+    }
+    LOCK(syncLock);
+    rc = Release(lid);
+    UNLOCK(syncLock);
+    return rc;
+}
+
+static int
+LockName(int lid, char *name, int len)
+{
+    int rc = P1_SUCCESS;
+
+    if ((lid < 0) || (lid >= P1_MAXLOCKS)) {
+        return P1_INVALID_LOCK;
+    }
+    if (name == NULL) {
+        return P1_NAME_IS_NULL;
+    }
+    LOCK(syncLock);
+    if (locks[lid].inUse) {
+        snprintf(name, len, "%s", locks[lid].name);
+    } else {
+        rc = P1_INVALID_LOCK;
+    }
+    UNLOCK(syncLock);
+    return rc;
+}
+
+static int
+CondCreate(char *name, int lid, int *vid)
+{
+    int rc;
+    int slot = -1;
+
+    LOCK(syncLock);
+    rc = CheckNewName(&condNames, name);
+    if ((rc == P1_SUCCESS) && ((lid < 0) || (lid >= P1_MAXLOCKS) || !locks[lid].inUse)) {
+        rc = P1_INVALID_LOCK;
+    }
+    for (int i = 0; (rc == P1_SUCCESS) && (slot == -1) && (i < P1_MAXCONDS); i++) {
+        if (!conds[i].inUse) {
+            slot = i;
+        }
+    }
+    if ((rc == P1_SUCCESS) && (slot == -1)) {
+        rc = P1_TOO_MANY_CONDS;
+    }
+    if (rc == P1_SUCCESS) {
+        Cond *cond = &conds[slot];
+        cond->inUse = TRUE;
+        snprintf(cond->name, sizeof(cond->name), "%s", name);
+        NamesAdd(&condNames, slot, cond->name);
+        cond->lid = lid;
+        cond->waiters.head = -1;
+        memset(&cond->stats, 0, sizeof(cond->stats));
+        cond->stats.maxHolder = -1;
+        *vid = slot;
+    }
+    UNLOCK(syncLock);
+    return rc;
+}
+
+static int
+CondFree(int vid)
+{
+    int rc = P1_SUCCESS;
+
+    if ((vid < 0) || (vid >= P1_MAXCONDS)) {
+        return P1_INVALID_COND;
+    }
+    LOCK(syncLock);
+    if (!conds[vid].inUse) {
+        rc = P1_INVALID_COND;
+    } else if (conds[vid].waiters.head != -1) {
+        rc = P1_BLOCKED_PROCESSES;
+    } else {
+        NamesRemove(&condNames, vid);
+        conds[vid].inUse = FALSE;
+    }
+    UNLOCK(syncLock);
+    return rc;
+}
+
+/*
+ * Signaled
+ *
+ * Finishes a wait on a condition variable that was signaled. CondSignal moved the process to
+ * the lock's queue and Release handed it the lock. Must be called with syncLock held.
+ */
+static void
+Signaled(Cond *cond, int pid)
+{
+    Lock *lock = &locks[cond->lid];
+
+    assert(Holder(cond->lid) == pid);
+    procs[pid].blockedOn = -1;
+    lock->holdStart = USLOSS_Clock();
+    lock->stats.acquires++;
+    lock->stats.contended++;
+    AddTime(&lock->stats.totalWait, &lock->stats.maxWait, lock->holdStart - procs[pid].signaled);
+    if (AddTime(&cond->stats.totalHold, &cond->stats.maxHold,
+                lock->holdStart - procs[pid].signaled)) {
+        cond->stats.maxHolder = pid;
+    }
+}
+
+/*
+ * CondWait
+ *
+ * Releases the condition variable's lock, waits until the condition variable is signaled, and
+ * reacquires the lock. The lock is released and the process queued atomically, so a signal
+ * can't be lost. The process doesn't run between being signaled and getting the lock.
+ */
+static int
+CondWait(int vid)
+{
+    int     pid = P1_GetPid();
+    Cond    *cond;
+    int     lid;
+    int     rc;
+
+    if ((vid < 0) || (vid >= P1_MAXCONDS)) {
+        return P1_INVALID_COND;
+    }
+    LOCK(syncLock);
+    cond = &conds[vid];
+    if (!cond->inUse) {
+        rc = P1_INVALID_COND;
+    } else if (!Holds(cond->lid)) {
+        rc = P1_LOCK_NOT_HELD;
+    } else {
+        lid = cond->lid;
+        rc = Release(lid);
+        assert(rc == P1_SUCCESS);
+        cond->stats.acquires++;
+        procs[pid].waitStart = USLOSS_Clock();
+        Enqueue(&cond->waiters, pid);
+        Block(pid);
+        Signaled(cond, pid);
+    }
+    UNLOCK(syncLock);
+    return rc;
+}
+
+/*
+ * CondSignal
+ *
+ * Signals the first process waiting on the condition variable, or all of them if "all" is
+ * TRUE. The caller must hold the condition variable's lock, so rather than waking the waiters
+ * only to have them block on the lock, it moves them to the lock's queue. They are then handed
+ * the lock one at a time as it is released.
+ */
+static int
+CondSignal(int vid, int all)
+{
+    Cond    *cond;
+    int     rc = P1_SUCCESS;
+    int     now = USLOSS_Clock();
+    int     pid;
+
+    if ((vid < 0) || (vid >= P1_MAXCONDS)) {
+        return P1_INVALID_COND;
+    }
+    LOCK(syncLock);
+    cond = &conds[vid];
+    if (!cond->inUse) {
+        rc = P1_INVALID_COND;
+    } else if (!Holds(cond->lid)) {
+        rc = P1_LOCK_NOT_HELD;
+    } else {
+        if (cond->waiters.head != -1) {
+            cond->stats.contended++;
+        }
+        do {
+            pid = Dequeue(&cond->waiters);
+            if (pid != -1) {
+                // the lock must be released through the kernel to hand it off
+                __atomic_fetch_or(&P2_LockWords[cond->lid], P2_LOCK_WAITERS, __ATOMIC_ACQ_REL);
+                Enqueue(&locks[cond->lid].waiters, pid);
+                Contend(cond->lid);
+                procs[pid].blockedOn = cond->lid;
+                Inherit(cond->lid, Priority(pid));
+                procs[pid].signaled = now;
+                procs[pid].event = P2_EVENT_COND;
+                AddTime(&cond->stats.totalWait, &cond->stats.maxWait, now - procs[pid].waitStart);
+            }
+        } while (all && (pid != -1));
+    }
+    UNLOCK(syncLock);
+    return rc;
+}
+
+static int
+CondName(int vid, char *name, int len)
+{
+    int rc = P1_SUCCESS;
+
+    if ((vid < 0) || (vid >= P1_MAXCONDS)) {
+        return P1_INVALID_COND;
+    }
+    if (name == NULL) {
+        return P1_NAME_IS_NULL;
+    }
+    LOCK(syncLock);
+    if (conds[vid].inUse) {
+        snprintf(name, len, "%s", conds[vid].name);
+    } else {
+        rc = P1_INVALID_COND;
+    }
+    UNLOCK(syncLock);
+    return rc;
+}
+
+/*
+ * Fire
+ *
+ * Ends the WaitEvents of a process with an event other than a signal. Must be called with
+ * syncLock held.
+ */
+static void
+Fire(int pid, int event)
+{
+    procs[pid].event = event;
+    if (procs[pid].eventCond != -1) {
+        Remove(&conds[procs[pid].eventCond].waiters, pid);
+    }
+    Wakeup(pid);
+}
+
+/*
+ * ChildQuit
+ *
+ * Returns TRUE if a child of the process has terminated but hasn't been waited for.
+ */
+static int
+ChildQuit(int pid)
+{
+    P1_ProcInfo info;
+    P1_ProcInfo child;
+    int         rc;
+
+    rc = P1_GetProcInfo(pid, &info);
+    assert(rc == P1_SUCCESS);
+    for (int i = 0; i < info.numChildren; i++) {
+        rc = P1_GetProcInfo(info.children[i], &child);
+        if ((rc == P1_SUCCESS) && (child.state == P1_STATE_QUIT)) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/*
+ * WaitEvents
+ *
+ * Waits until the condition variable is signaled, the timeout in microseconds expires, or a
+ * child terminates, whichever is first, and returns which in *event. Any of them may be omitted
+ * with -1, -1, and FALSE respectively. As with CondWait the caller must hold the condition
+ * variable's lock, which is released while waiting and held again on return whatever the event.
+ * Timeouts are checked on each clock interrupt. A child that terminated before the call ends it
+ * immediately; the caller collects it with Sys_Wait.
+ */
+static int
+WaitEvents(int vid, int timeout, int children, int *event)
+{
+    int     pid = P1_GetPid();
+    Cond    *cond = NULL;
+    int     rc = P1_SUCCESS;
+
+    if ((vid == -1) && (timeout == -1) && !children) {
+        return P2_INVALID_ARGUMENT;
+    }
+    if ((vid < -1) || (vid >= P1_MAXCONDS)) {
+        return P1_INVALID_COND;
+    }
+    if (timeout < -1) {
+        return P2_INVALID_ARGUMENT;
+    }
+    LOCK(syncLock);
+    if (vid != -1) {
+        cond = &conds[vid];
+        if (!cond->inUse) {
+            rc = P1_INVALID_COND;
+        } else if (!Holds(cond->lid)) {
+            rc = P1_LOCK_NOT_HELD;
+        }
+    }
+    if (rc != P1_SUCCESS) {
+        // nothing to wait for
+    } else if (children && ChildQuit(pid)) {
+        *event = P2_EVENT_CHILD;
+    } else if (timeout == 0) {
+        *event = P2_EVENT_TIMER;
+    } else {
+        procs[pid].event = 0;
+        procs[pid].eventCond = vid;
+        procs[pid].deadline = (timeout == -1) ? -1 : USLOSS_Clock() + timeout;
+        procs[pid].children = children;
+        if (cond != NULL) {
+            rc = Release(cond->lid);
+            assert(rc == P1_SUCCESS);
+            cond->stats.acquires++;
+            procs[pid].waitStart = USLOSS_Clock();
+            Enqueue(&cond->waiters, pid);
+        }
+        Block(pid);
+        *event = procs[pid].event;
+        procs[pid].eventCond = -1;
+        procs[pid].deadline = -1;
+        procs[pid].children = FALSE;
+        if (*event == P2_EVENT_COND) {
+            Signaled(cond, pid);
+        } else if (cond != NULL) {
+            rc = Acquire(cond->lid);
+            assert(rc == P1_SUCCESS);
+        }
+    }
+    UNLOCK(syncLock);
+    return rc;
+}
+
+/*
+ * EventTick
+ *
+ * Clock handler that ends the WaitEvents of processes whose timeouts have expired.
+ */
+static void
+EventTick(int now)
+{
+    LOCK(syncLock);
+    for (int pid = 0; pid < P1_MAXPROC; pid++) {
+        if ((procs[pid].deadline != -1) && (procs[pid].event == 0) &&
+            (now >= procs[pid].deadline)) {
+            Fire(pid, P2_EVENT_TIMER);
+        }
+    }
+    UNLOCK(syncLock);
+}
+
+static int
+RwLockCreate(char *name, int *id)
+{
+    int rc;
+    int slot = -1;
+
+    LOCK(syncLock);
+    rc = CheckNewName(&rwlockNames, name);
+    for (int i = 0; (rc == P1_SUCCESS) && (slot == -1) && (i < MAX_RWLOCKS); i++) {
+        if (!rwlocks[i].inUse) {
+            slot = i;
+        }
+    }
+    if ((rc == P1_SUCCESS) && (slot == -1)) {
+        rc = P2_TOO_MANY_OBJECTS;
+    }
+    if (rc == P1_SUCCESS) {
+        RwLock *rw = &rwlocks[slot];
+        memset(rw, 0, sizeof(*rw));
+        rw->inUse = TRUE;
+        snprintf(rw->name, sizeof(rw->name), "%s", name);
+        NamesAdd(&rwlockNames, slot, rw->name);
+        rw->writer = -1;
+        rw->waiters.head = -1;
+        *id = slot;
+    }
+    UNLOCK(syncLock);
+    return rc;
+}
+
+static int
+RwLockFree(int id)
+{
+    int rc = P1_SUCCESS;
+
+    if ((id < 0) || (id >= MAX_RWLOCKS)) {
+        return P2_INVALID_ARGUMENT;
+    }
+    LOCK(syncLock);
+    if (!rwlocks[id].inUse) {
+        rc = P2_INVALID_ARGUMENT;
+    } else if (rwlocks[id].waiters.head != -1) {
+        rc = P1_BLOCKED_PROCESSES;
+    } else if ((rwlocks[id].writer != -1) || (rwlocks[id].numReaders > 0)) {
+        rc = P1_LOCK_HELD;
+    } else {
+        NamesRemove(&rwlockNames, id);
+        rwlocks[id].inUse = FALSE;
+    }
+    UNLOCK(syncLock);
+    return rc;
+}
+
+/*
+ * RwLockAcquire
+ *
+ * Acquires the reader-writer lock for writing if "write" is TRUE, else for reading. Waits if
+ * the lock is held by a writer, or if it is held at all or there are waiters.
+ */
+static int
+RwLockAcquire(int id, int write)
+{
+    int     pid = P1_GetPid();
+    RwLock  *rw;
+    int     rc = P1_SUCCESS;
+
+    if ((id < 0) || (id >= MAX_RWLOCKS)) {
+        return P2_INVALID_ARGUMENT;
+    }
+    LOCK(syncLock);
+    rw = &rwlocks[id];
+    if (!rw->inUse) {
+        rc = P2_INVALID_ARGUMENT;
+    } else if ((rw->writer == pid) || rw->readers[pid]) {
+        rc = P1_LOCK_HELD;
+    } else if ((rw->writer == -1) && (rw->waiters.head == -1) &&
+               (!write || (rw->numReaders == 0))) {
+        if (write) {
+            rw->writer = pid;
+        } else {
+            rw->readers[pid] = TRUE;
+            rw->numReaders++;
+        }
+    } else {
+        // the releasing process hands the lock off
+        procs[pid].write = write;
+        Enqueue(&rw->waiters, pid);
+        Block(pid);
+    }
+    UNLOCK(syncLock);
+    return rc;
+}
+
+/*
+ * RwLockRelease
+ *
+ * Releases the reader-writer lock held by the current process, for reading or writing. If the
+ * lock is now free it is handed off to the first waiter if it is a writer, else to all readers at
+ * the head of the queue.
+ */
+static int
+RwLockRelease(int id)
+{
+    int     pid = P1_GetPid();
+    RwLock  *rw;
+    int     rc = P1_SUCCESS;
+    int     next;
+
+    if ((id < 0) || (id >= MAX_RWLOCKS)) {
+        return P2_INVALID_ARGUMENT;
+    }
+    LOCK(syncLock);
+    rw = &rwlocks[id];
+    if (!rw->inUse) {
+        rc = P2_INVALID_ARGUMENT;
+    } else if (rw->writer == pid) {
+        rw->writer = -1;
+    } else if (rw->readers[pid]) {
+        rw->readers[pid] = FALSE;
+        rw->numReaders--;
+    } else {
+        rc = P1_LOCK_NOT_HELD;
+    }
+    if ((rc == P1_SUCCESS) && (rw->writer == -1) && (rw->numReaders == 0)) {
+        if ((rw->waiters.head != -1) && procs[rw->waiters.head].write) {
+            rw->writer = Dequeue(&rw->waiters);
+            Wakeup(rw->writer);
+        }
+        while ((rw->writer == -1) && (rw->waiters.head != -1) && !procs[rw->waiters.head].write) {
+            next = Dequeue(&rw->waiters);
+            rw->readers[next] = TRUE;
+            rw->numReaders++;
+            Wakeup(next);
+        }
+    }
+    UNLOCK(syncLock);
+    return rc;
+}
+
+static int
+SemCreate(char *name, int value, int *id)
+{
+    int rc;
+    int slot = -1;
+
+    if (value < 0) {
+        return P2_INVALID_ARGUMENT;
+    }
+    LOCK(syncLock);
+    rc = CheckNewName(&semNames, name);
+    for (int i = 0; (rc == P1_SUCCESS) && (slot == -1) && (i < MAX_SEMS); i++) {
+        if (!sems[i].inUse) {
+            slot = i;
+        }
+    }
+    if ((rc == P1_SUCCESS) && (slot == -1)) {
+        rc = P2_TOO_MANY_OBJECTS;
+    }
+    if (rc == P1_SUCCESS) {
+        Sem *sem = &sems[slot];
+        sem->inUse = TRUE;
+        snprintf(sem->name, sizeof(sem->name), "%s", name);
+        NamesAdd(&semNames, slot, sem->name);
+        sem->value = value;
+        sem->waiters.head = -1;
+        *id = slot;
+    }
+    UNLOCK(syncLock);
+    return rc;
+}
+
+static int
+SemFree(int id)
+{
+    int rc = P1_SUCCESS;
+
+    if ((id < 0) || (id >= MAX_SEMS)) {
+        return P2_INVALID_ARGUMENT;
+    }
+    LOCK(syncLock);
+    if (!sems[id].inUse) {
+        rc = P2_INVALID_ARGUMENT;
+    } else if (sems[id].waiters.head != -1) {
+        rc = P1_BLOCKED_PROCESSES;
+    } else {
+        NamesRemove(&semNames, id);
+        sems[id].inUse = FALSE;
+    }
+    UNLOCK(syncLock);
+    return rc;
+}
+
+/*
+ * SemP
+ *
+ * Takes count units from the semaphore, waiting until they are available unless "try" is TRUE,
+ * in which case it returns P2_WOULD_BLOCK.
+ */
+static int
+SemP(int id, int count, int try)
+{
+    int     pid = P1_GetPid();
+    Sem     *sem;
+    int     rc = P1_SUCCESS;
+
+    if ((id < 0) || (id >= MAX_SEMS) || (count <= 0)) {
+        return P2_INVALID_ARGUMENT;
+    }
+    LOCK(syncLock);
+    sem = &sems[id];
+    if (!sem->inUse) {
+        rc = P2_INVALID_ARGUMENT;
+    } else if ((sem->waiters.head == -1) && (sem->value >= count)) {
+        sem->value -= count;
+    } else if (try) {
+        rc = P2_WOULD_BLOCK;
+    } else {
+        // SemV takes the units on the process's behalf
+        procs[pid].count = count;
+        Enqueue(&sem->waiters, pid);
+        Block(pid);
+    }
+    UNLOCK(syncLock);
+    return rc;
+}
+
+/*
+ * SemV
+ *
+ * Returns count units to the semaphore and wakes up the waiters at the head of the queue whose
+ * requests can now be satisfied.
+ */
+static int
+SemV(int id, int count)
+{
+    Sem     *sem;
+    int     rc = P1_SUCCESS;
+    int     pid;
+
+    if ((id < 0) || (id >= MAX_SEMS) || (count <= 0)) {
+        return P2_INVALID_ARGUMENT;
+    }
+    LOCK(syncLock);
+    sem = &sems[id];
+    if (!sem->inUse) {
+        rc = P2_INVALID_ARGUMENT;
+    } else {
+        sem->value += count;
+        while ((sem->waiters.head != -1) && (procs[sem->waiters.head].count <= sem->value)) {
+            pid = Dequeue(&sem->waiters);
+            sem->value -= procs[pid].count;
+            Wakeup(pid);
+        }
+    }
+    UNLOCK(syncLock);
+    return rc;
+}
+
+static int
+BarrierCreate(char *name, int count, int *id)
+{
+    int rc;
+    int slot = -1;
+
+    if (count <= 0) {
+        return P2_INVALID_ARGUMENT;
+    }
+    LOCK(syncLock);
+    rc = CheckNewName(&barrierNames, name);
+    for (int i = 0; (rc == P1_SUCCESS) && (slot == -1) && (i < MAX_BARRIERS); i++) {
+        if (!barriers[i].inUse) {
+            slot = i;
+        }
+    }
+    if ((rc == P1_SUCCESS) && (slot == -1)) {
+        rc = P2_TOO_MANY_OBJECTS;
+    }
+    if (rc == P1_SUCCESS) {
+        Barrier *barrier = &barriers[slot];
+        barrier->inUse = TRUE;
+        snprintf(barrier->name, sizeof(barrier->name), "%s", name);
+        NamesAdd(&barrierNames, slot, barrier->name);
+        barrier->count = count;
+        barrier->arrived = 0;
+        barrier->waiters.head = -1;
+        *id = slot;
+    }
+    UNLOCK(syncLock);
+    return rc;
+}
+
+static int
+BarrierFree(int id)
+{
+    int rc = P1_SUCCESS;
+
+    if ((id < 0) || (id >= MAX_BARRIERS)) {
+        return P2_INVALID_ARGUMENT;
+    }
+    LOCK(syncLock);
+    if (!barriers[id].inUse) {
+        rc = P2_INVALID_ARGUMENT;
+    } else if (barriers[id].arrived > 0) {
+        rc = P1_BLOCKED_PROCESSES;
+    } else {
+        NamesRemove(&barrierNames, id);
+        barriers[id].inUse = FALSE;
+    }
+    UNLOCK(syncLock);
+    return rc;
+}
+
+/*
+ * BarrierWait
+ *
+ * Waits until all processes in the barrier's group have called BarrierWait. The last one to
+ * arrive wakes the others and doesn't block.
+ */
+static int
+BarrierWait(int id)
+{
+    int     pid = P1_GetPid();
+    Barrier *barrier;
+    int     rc = P1_SUCCESS;
+    int     next;
+
+    if ((id < 0) || (id >= MAX_BARRIERS)) {
+        return P2_INVALID_ARGUMENT;
+    }
+    LOCK(syncLock);
+    barrier = &barriers[id];
+    if (!barrier->inUse) {
+        rc = P2_INVALID_ARGUMENT;
+    } else if (++barrier->arrived < barrier->count) {
+        Enqueue(&barrier->waiters, pid);
+        Block(pid);
+    } else {
+        while ((next = Dequeue(&barrier->waiters)) != -1) {
+            Wakeup(next);
+        }
+        barrier->arrived = 0;
+    }
+    UNLOCK(syncLock);
+    return rc;
+}
+
+static int
+MailboxCreate(char *name, int slots, int size, int *id)
+{
+    int rc;
+    int slot = -1;
+
+    if ((slots < 0) || (size <= 0)) {
+        return P2_INVALID_ARGUMENT;
+    }
+    LOCK(syncLock);
+    rc = CheckNewName(&mailboxNames, name);
+    for (int i = 0; (rc == P1_SUCCESS) && (slot == -1) && (i < MAX_MAILBOXES); i++) {
+        if (!mailboxes[i].inUse) {
+            slot = i;
+        }
+    }
+    if ((rc == P1_SUCCESS) && (slot == -1)) {
+        rc = P2_TOO_MANY_OBJECTS;
+    }
+    if (rc == P1_SUCCESS) {
+        Mailbox *mbox = &mailboxes[slot];
+        mbox->inUse = TRUE;
+        snprintf(mbox->name, sizeof(mbox->name), "%s", name);
+        NamesAdd(&mailboxNames, slot, mbox->name);
+        mbox->numSlots = slots;
+        mbox->maxSize = size;
+        mbox->data = NULL;
+        mbox->sizes = NULL;
+        if (slots > 0) {
+            // a mailbox with no slots never stores a message
+            mbox->data = malloc(slots * size);
+            mbox->sizes = malloc(slots * sizeof(int));
+            assert((mbox->data != NULL) && (mbox->sizes != NULL));
+        }
+        mbox->head = 0;
+        mbox->count = 0;
+        mbox->senders.head = -1;
+        mbox->receivers.head = -1;
+        *id = slot;
+    }
+    UNLOCK(syncLock);
+    return rc;
+}
+
+static int
+MailboxFree(int id)
+{
+    int rc = P1_SUCCESS;
+
+    if ((id < 0) || (id >= MAX_MAILBOXES)) {
+        return P2_INVALID_ARGUMENT;
+    }
+    LOCK(syncLock);
+    if (!mailboxes[id].inUse) {
+        rc = P2_INVALID_ARGUMENT;
+    } else if ((mailboxes[id].senders.head != -1) || (mailboxes[id].receivers.head != -1)) {
+        rc = P1_BLOCKED_PROCESSES;
+    } else {
+        free(mailboxes[id].data);
+        free(mailboxes[id].sizes);
+        NamesRemove(&mailboxNames, id);
+        mailboxes[id].inUse = FALSE;
+    }
+    UNLOCK(syncLock);
+    return rc;
+}
+
+/*
+ * Deliver
+ *
+ * Copies a message into the buffer of the first receiver waiting on the mailbox and wakes it up.
+ * A receiver whose buffer is too small is woken up with the message's size but not the message,
+ * which goes to the next receiver instead. Returns TRUE if a receiver got the message.
+ */
+static int
+Deliver(Mailbox *mbox, void *msg, int size)
+{
+    int pid;
+    int fits;
+
+    while ((pid = Dequeue(&mbox->receivers)) != -1) {
+        fits = (size <= procs[pid].size);
+        if (fits) {
+            memcpy(procs[pid].buffer, msg, size);
+        }
+        procs[pid].size = size;
+        Wakeup(pid);
+        if (fits) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/*
+ * Store
+ *
+ * Copies a message into the next free slot of the mailbox.
+ */
+static void
+Store(Mailbox *mbox, void *msg, int size)
+{
+    int slot = (mbox->head + mbox->count) % mbox->numSlots;
+
+    memcpy(&mbox->data[slot * mbox->maxSize], msg, size);
+    mbox->sizes[slot] = size;
+    mbox->count++;
+}
+
+/*
+ * MailboxSend
+ *
+ * Sends a message of up to the mailbox's maximum size. Waits for a free slot or a receiver
+ * unless "try" is TRUE, in which case it returns P2_WOULD_BLOCK.
+ */
+static int
+MailboxSend(int id, void *msg, int size, int try)
+{
+    int     pid = P1_GetPid();
+    Mailbox *mbox;
+    int     rc = P1_SUCCESS;
+
+    if ((id < 0) || (id >= MAX_MAILBOXES) || (size < 0)) {
+        return P2_INVALID_ARGUMENT;
+    }
+    if ((msg == NULL) && (size > 0)) {
+        return P2_NULL_ADDRESS;
+    }
+    LOCK(syncLock);
+    mbox = &mailboxes[id];
+    if (!mbox->inUse || (size > mbox->maxSize)) {
+        rc = P2_INVALID_ARGUMENT;
+    } else if (Deliver(mbox, msg, size)) {
+        // a waiting receiver got the message
+    } else if (mbox->count < mbox->numSlots) {
+        Store(mbox, msg, size);
+    } else if (try) {
+        rc = P2_WOULD_BLOCK;
+    } else {
+        // a receiver copies the message
+        procs[pid].buffer = msg;
+        procs[pid].size = size;
+        Enqueue(&mbox->senders, pid);
+        Block(pid);
+    }
+    UNLOCK(syncLock);
+    return rc;
+}
+
+/*
+ * MailboxReceive
+ *
+ * Receives a message into the buffer and returns its size in *size. Waits for a message unless
+ * "try" is TRUE, in which case it returns P2_WOULD_BLOCK. If the buffer is too small it returns
+ * P2_BUFFER_TOO_SMALL with the message's size in *size and leaves the message to be received.
+ */
+static int
+MailboxReceive(int id, void *buffer, int *size, int try)
+{
+    int     pid = P1_GetPid();
+    Mailbox *mbox;
+    int     rc = P1_SUCCESS;
+    int     len;
+    int     sender;
+    int     avail = *size;
+
+    if ((id < 0) || (id >= MAX_MAILBOXES) || (*size < 0)) {
+        return P2_INVALID_ARGUMENT;
+    }
+    if ((buffer == NULL) && (*size > 0)) {
+        return P2_NULL_ADDRESS;
+    }
+    LOCK(syncLock);
+    mbox = &mailboxes[id];
+    if (!mbox->inUse) {
+        rc = P2_INVALID_ARGUMENT;
+    } else if ((mbox->count > 0) && (mbox->sizes[mbox->head] > avail)) {
+        *size = mbox->sizes[mbox->head];
+        rc = P2_BUFFER_TOO_SMALL;
+    } else if (mbox->count > 0) {
+        len = mbox->sizes[mbox->head];
+        memcpy(buffer, &mbox->data[mbox->head * mbox->maxSize], len);
+        *size = len;
+        mbox->head = (mbox->head + 1) % mbox->numSlots;
+        mbox->count--;
+        if (mbox->senders.head != -1) {
+            sender = Dequeue(&mbox->senders);
+            Store(mbox, procs[sender].buffer, procs[sender].size);
+            Wakeup(sender);
+        }
+    } else if ((mbox->senders.head != -1) && (procs[mbox->senders.head].size > avail)) {
+        *size = procs[mbox->senders.head].size;
+        rc = P2_BUFFER_TOO_SMALL;
+    } else if (mbox->senders.head != -1) {
+        sender = Dequeue(&mbox->senders);
+        len = procs[sender].size;
+        memcpy(buffer, procs[sender].buffer, len);
+        *size = len;
+        Wakeup(sender);
+    } else if (try) {
+        rc = P2_WOULD_BLOCK;
+    } else {
+        // a sender copies the message and its size, or only its size if it doesn't fit
+        procs[pid].buffer = buffer;
+        procs[pid].size = avail;
+        Enqueue(&mbox->receivers, pid);
+        Block(pid);
+        *size = procs[pid].size;
+        if (*size > avail) {
+            rc = P2_BUFFER_TOO_SMALL;
+        }
+    }
+    UNLOCK(syncLock);
+    return rc;
+}
+
+/*
+ * LockLookup
+ *
+ * Returns the id of the lock, or the condition variable if cond is TRUE, with the name.
+ */
+static int
+LockLookup(char *name, int cond, int *id)
+{
+    int rc = CheckName(name);
+
+    if (rc != P1_SUCCESS) {
+        return rc;
+    }
+    LOCK(syncLock);
+    *id = NamesFind(cond ? &condNames : &lockNames, name);
+    if (*id == -1) {
+        rc = cond ? P1_INVALID_COND : P1_INVALID_LOCK;
+    }
+    UNLOCK(syncLock);
+    return rc;
+}
+
+/*
+ * P2LockStats
+ *
+ * Returns the contention statistics of the lock, or of the condition variable if "cond" is
+ * TRUE.
+ */
+int
+P2LockStats(int id, int cond, P2_LockStats *stats)
+{
+    int rc = P1_SUCCESS;
+
+    if (stats == NULL) {
+        return P2_NULL_ADDRESS;
+    }
+    LOCK(syncLock);
+    if (cond) {
+        if ((id < 0) || (id >= P1_MAXCONDS) || !conds[id].inUse) {
+            rc = P1_INVALID_COND;
+        } else {
+            *stats = conds[id].stats;
+            snprintf(stats->name, sizeof(stats->name), "%s", conds[id].name);
+        }
+    } else {
+        if ((id < 0) || (id >= P1_MAXLOCKS) || !locks[id].inUse) {
+            rc = P1_INVALID_LOCK;
+        } else {
+            *stats = locks[id].stats;
+            stats->acquires += P2_LockFastAcquires[id];
+            snprintf(stats->name, sizeof(stats->name), "%s", locks[id].name);
+        }
+    }
+    UNLOCK(syncLock);
+    return rc;
+}
+
+/*
+ * SyncExit
+ *
+ * Clears the inherited priority of a process that terminated, here and for its disk requests,
+ * so that it doesn't pass to the next process with its pid, and ends the WaitEvents of its
+ * parent if it waits for children.
+ */
+static void
+SyncExit(int pid)
+{
+    P1_ProcInfo info;
+    int         rc;
+
+    rc = P1_GetProcInfo(pid, &info);
+    assert(rc == P1_SUCCESS);
+    LOCK(syncLock);
+    procs[pid].boost = 0;
+    rc = P2DiskInherit(pid, 0);
+    assert(rc == P1_SUCCESS);
+    procs[pid].blockedOn = -1;
+    if ((info.parent >= 0) && procs[info.parent].children && (procs[info.parent].event == 0)) {
+        Fire(info.parent, P2_EVENT_CHILD);
+    }
+    UNLOCK(syncLock);
+}
+
+/*
+ * SyncInit
+ *
+ * Initializes the locks, condition variables, and the other synchronization objects and installs
+ * their system call handlers.
+ */
+static void
+SyncInit(void)
+{
+    char    name[P1_MAXNAME];
+    int     rc;
+
+    rc = P1_LockCreate("Sync Lock", &syncLock);
+    assert(rc == P1_SUCCESS);
+    for (int i = 0; i < P1_MAXPROC; i++) {
+        snprintf(name, sizeof(name), "Sync %d", i);
+        rc = P1_CondCreate(name, syncLock, &procs[i].cond);
+        assert(rc == P1_SUCCESS);
+        procs[i].blockedOn = -1;
+        procs[i].contended = -1;
+        procs[i].eventCond = -1;
+        procs[i].deadline = -1;
+    }
+    for (int i = 0; i < P1_MAXLOCKS; i++) {
+        P2_LockWords[i] = P2_LOCK_INVALID;
+    }
+    NamesInit(&lockNames);
+    NamesInit(&condNames);
+    NamesInit(&rwlockNames);
+    NamesInit(&semNames);
+    NamesInit(&barrierNames);
+    NamesInit(&mailboxNames);
+    rc = P2ProcRegisterExit(SyncExit);
+    assert(rc == P1_SUCCESS);
+    rc = P2ClockRegister(EventTick);
+    assert(rc == P1_SUCCESS);
+
+    rc = P2_SetSyscallHandler(SYS_LOCKCREATE, LockCreateStub);
+    assert(rc == P1_SUCCESS);
+    rc = P2_SetSyscallHandler(SYS_LOCKFREE, LockFreeStub);
+    assert(rc == P1_SUCCESS);
+    rc = P2_SetSyscallHandler(SYS_LOCKACQUIRE, LockAcquireStub);
+    assert(rc == P1_SUCCESS);
+    rc = P2_SetSyscallHandler(SYS_LOCKRELEASE, LockReleaseStub);
+    assert(rc == P1_SUCCESS);
+    rc = P2_SetSyscallHandler(SYS_LOCKNAME, LockNameStub);
+    assert(rc == P1_SUCCESS);
+    rc = P2_SetSyscallHandler(SYS_CONDCREATE, CondCreateStub);
+    assert(rc == P1_SUCCESS);
+    rc = P2_SetSyscallHandler(SYS_CONDFREE, CondFreeStub);
+    assert(rc == P1_SUCCESS);
+    rc = P2_SetSyscallHandler(SYS_CONDWAIT, CondWaitStub);
+    assert(rc == P1_SUCCESS);
+    rc = P2_SetSyscallHandler(SYS_CONDSIGNAL, CondSignalStub);
+    assert(rc == P1_SUCCESS);
+    rc = P2_SetSyscallHandler(SYS_CONDBROADCAST, CondBroadcastStub);
+    assert(rc == P1_SUCCESS);
+    rc = P2_SetSyscallHandler(SYS_CONDNAME, CondNameStub);
+    assert(rc == P1_SUCCESS);
+    rc = P2_SetSyscallHandler(SYS_RWLOCKCREATE, RwLockCreateStub);
+    assert(rc == P1_SUCCESS);
+    rc = P2_SetSyscallHandler(SYS_RWLOCKFREE, RwLockFreeStub);
+    assert(rc == P1_SUCCESS);
+    rc = P2_SetSyscallHandler(SYS_RWLOCKACQUIRE, RwLockAcquireStub);
+    assert(rc == P1_SUCCESS);
+    rc = P2_SetSyscallHandler(SYS_RWLOCKRELEASE, RwLockReleaseStub);
+    assert(rc == P1_SUCCESS);
+    rc = P2_SetSyscallHandler(SYS_SEMCREATE, SemCreateStub);
+    assert(rc == P1_SUCCESS);
+    rc = P2_SetSyscallHandler(SYS_SEMFREE, SemFreeStub);
+    assert(rc == P1_SUCCESS);
+    rc = P2_SetSyscallHandler(SYS_SEMP, SemPStub);
+    assert(rc == P1_SUCCESS);
+    rc = P2_SetSyscallHandler(SYS_SEMV, SemVStub);
+    assert(rc == P1_SUCCESS);
+    rc = P2_SetSyscallHandler(SYS_BARRIERCREATE, BarrierCreateStub);
+    assert(rc == P1_SUCCESS);
+    rc = P2_SetSyscallHandler(SYS_BARRIERFREE, BarrierFreeStub);
+    assert(rc == P1_SUCCESS);
+    rc = P2_SetSyscallHandler(SYS_BARRIERWAIT, BarrierWaitStub);
+    assert(rc == P1_SUCCESS);
+    rc = P2_SetSyscallHandler(SYS_LOCKSTATS, LockStatsStub);
+    assert(rc == P1_SUCCESS);
+    rc = P2_SetSyscallHandler(SYS_LOCKLOOKUP, LockLookupStub);
+    assert(rc == P1_SUCCESS);
+    rc = P2_SetSyscallHandler(SYS_WAITEVENTS, WaitEventsStub);
+    assert(rc == P1_SUCCESS);
+    rc = P2_SetSyscallHandler(SYS_MAILBOXCREATE, MailboxCreateStub);
+    assert(rc == P1_SUCCESS);
+    rc = P2_SetSyscallHandler(SYS_MAILBOXFREE, MailboxFreeStub);
+    assert(rc == P1_SUCCESS);
+    rc = P2_SetSyscallHandler(SYS_MAILBOXSEND, MailboxSendStub);
+    assert(rc == P1_SUCCESS);
+    rc = P2_SetSyscallHandler(SYS_MAILBOXRECEIVE, MailboxReceiveStub);
+    assert(rc == P1_SUCCESS);
+}
+
 int P2_Startup(void *arg)
 {
-    int rc, pid;
+    int rc, pid, status;
 
     P2ClockInit();
     P2DiskInit();
 
     // install system call handlers
+    SyncInit();
 
     rc = P2_Spawn("P3_Startup", P3_Startup, NULL, 4*USLOSS_MIN_STACK, 2, &pid);
     assert(rc == P1_SUCCESS);
-    
+
     // wait for P3_Startup to terminate
+    rc = P2_Wait(&pid, &status);
+    assert(rc == P1_SUCCESS);
 
     P2DiskShutdown();
     P2ClockShutdown();
@@ -29,3 +1883,242 @@ int P2_Startup(void *arg)
     return 0;
 }
 
+static void
+LockCreateStub(USLOSS_Sysargs *sysargs)
+{
+    int lid;
+    int rc = LockCreate((char *) sysargs->arg1, &lid);
+    if (rc == P1_SUCCESS) {
+        sysargs->arg1 = (void *) lid;
+    }
+    sysargs->arg4 = (void *) rc;
+}
+
+static void
+LockStatsStub(USLOSS_Sysargs *sysargs)
+{
+    int rc = P2LockStats((int) sysargs->arg1, (int) sysargs->arg3, (P2_LockStats *) sysargs->arg2);
+    sysargs->arg4 = (void *) rc;
+}
+
+static void
+LockLookupStub(USLOSS_Sysargs *sysargs)
+{
+    int id;
+    int rc = LockLookup((char *) sysargs->arg1, (int) sysargs->arg2, &id);
+    if (rc == P1_SUCCESS) {
+        sysargs->arg1 = (void *) id;
+    }
+    sysargs->arg4 = (void *) rc;
+}
+
+static void
+WaitEventsStub(USLOSS_Sysargs *sysargs)
+{
+    int event;
+    int rc = WaitEvents((int) sysargs->arg1, (int) sysargs->arg2, (int) sysargs->arg3, &event);
+    if (rc == P1_SUCCESS) {
+        sysargs->arg1 = (void *) event;
+    }
+    sysargs->arg4 = (void *) rc;
+}
+
+static void
+LockFreeStub(USLOSS_Sysargs *sysargs)
+{
+    int rc = LockFree((int) sysargs->arg1);
+    sysargs->arg4 = (void *) rc;
+}
+
+static void
+LockAcquireStub(USLOSS_Sysargs *sysargs)
+{
+    int rc = LockAcquire((int) sysargs->arg1);
+    sysargs->arg4 = (void *) rc;
+}
+
+static void
+LockReleaseStub(USLOSS_Sysargs *sysargs)
+{
+    int rc = LockRelease((int) sysargs->arg1);
+    sysargs->arg4 = (void *) rc;
+}
+
+static void
+LockNameStub(USLOSS_Sysargs *sysargs)
+{
+    int rc = LockName((int) sysargs->arg1, (char *) sysargs->arg2, (int) sysargs->arg3);
+    sysargs->arg4 = (void *) rc;
+}
+
+static void
+CondCreateStub(USLOSS_Sysargs *sysargs)
+{
+    int vid;
+    int rc = CondCreate((char *) sysargs->arg1, (int) sysargs->arg2, &vid);
+    if (rc == P1_SUCCESS) {
+        sysargs->arg1 = (void *) vid;
+    }
+    sysargs->arg4 = (void *) rc;
+}
+
+static void
+CondFreeStub(USLOSS_Sysargs *sysargs)
+{
+    int rc = CondFree((int) sysargs->arg1);
+    sysargs->arg4 = (void *) rc;
+}
+
+static void
+CondWaitStub(USLOSS_Sysargs *sysargs)
+{
+    int rc = CondWait((int) sysargs->arg1);
+    sysargs->arg4 = (void *) rc;
+}
+
+static void
+CondSignalStub(USLOSS_Sysargs *sysargs)
+{
+    int rc = CondSignal((int) sysargs->arg1, FALSE);
+    sysargs->arg4 = (void *) rc;
+}
+
+static void
+CondBroadcastStub(USLOSS_Sysargs *sysargs)
+{
+    int rc = CondSignal((int) sysargs->arg1, TRUE);
+    sysargs->arg4 = (void *) rc;
+}
+
+static void
+CondNameStub(USLOSS_Sysargs *sysargs)
+{
+    int rc = CondName((int) sysargs->arg1, (char *) sysargs->arg2, (int) sysargs->arg3);
+    sysargs->arg4 = (void *) rc;
+}
+
+static void
+RwLockCreateStub(USLOSS_Sysargs *sysargs)
+{
+    int id;
+    int rc = RwLockCreate((char *) sysargs->arg1, &id);
+    if (rc == P1_SUCCESS) {
+        sysargs->arg1 = (void *) id;
+    }
+    sysargs->arg4 = (void *) rc;
+}
+
+static void
+RwLockFreeStub(USLOSS_Sysargs *sysargs)
+{
+    int rc = RwLockFree((int) sysargs->arg1);
+    sysargs->arg4 = (void *) rc;
+}
+
+static void
+RwLockAcquireStub(USLOSS_Sysargs *sysargs)
+{
+    int rc = RwLockAcquire((int) sysargs->arg1, (int) sysargs->arg2);
+    sysargs->arg4 = (void *) rc;
+}
+
+static void
+RwLockReleaseStub(USLOSS_Sysargs *sysargs)
+{
+    int rc = RwLockRelease((int) sysargs->arg1);
+    sysargs->arg4 = (void *) rc;
+}
+
+static void
+SemCreateStub(USLOSS_Sysargs *sysargs)
+{
+    int id;
+    int rc = SemCreate((char *) sysargs->arg1, (int) sysargs->arg2, &id);
+    if (rc == P1_SUCCESS) {
+        sysargs->arg1 = (void *) id;
+    }
+    sysargs->arg4 = (void *) rc;
+}
+
+static void
+SemFreeStub(USLOSS_Sysargs *sysargs)
+{
+    int rc = SemFree((int) sysargs->arg1);
+    sysargs->arg4 = (void *) rc;
+}
+
+static void
+SemPStub(USLOSS_Sysargs *sysargs)
+{
+    int rc = SemP((int) sysargs->arg1, (int) sysargs->arg2, (int) sysargs->arg3);
+    sysargs->arg4 = (void *) rc;
+}
+
+static void
+SemVStub(USLOSS_Sysargs *sysargs)
+{
+    int rc = SemV((int) sysargs->arg1, (int) sysargs->arg2);
+    sysargs->arg4 = (void *) rc;
+}
+
+static void
+BarrierCreateStub(USLOSS_Sysargs *sysargs)
+{
+    int id;
+    int rc = BarrierCreate((char *) sysargs->arg1, (int) sysargs->arg2, &id);
+    if (rc == P1_SUCCESS) {
+        sysargs->arg1 = (void *) id;
+    }
+    sysargs->arg4 = (void *) rc;
+}
+
+static void
+BarrierFreeStub(USLOSS_Sysargs *sysargs)
+{
+    int rc = BarrierFree((int) sysargs->arg1);
+    sysargs->arg4 = (void *) rc;
+}
+
+static void
+BarrierWaitStub(USLOSS_Sysargs *sysargs)
+{
+    int rc = BarrierWait((int) sysargs->arg1);
+    sysargs->arg4 = (void *) rc;
+}
+
+static void
+MailboxCreateStub(USLOSS_Sysargs *sysargs)
+{
+    int id;
+    int rc = MailboxCreate((char *) sysargs->arg1, (int) sysargs->arg2, (int) sysargs->arg3, &id);
+    if (rc == P1_SUCCESS) {
+        sysargs->arg1 = (void *) id;
+    }
+    sysargs->arg4 = (void *) rc;
+}
+
+static void
+MailboxFreeStub(USLOSS_Sysargs *sysargs)
+{
+    int rc = MailboxFree((int) sysargs->arg1);
+    sysargs->arg4 = (void *) rc;
+}
+
+static void
+MailboxSendStub(USLOSS_Sysargs *sysargs)
+{
+    int rc = MailboxSend((int) sysargs->arg1, sysargs->arg2, (int) sysargs->arg3,
+                         (int) sysargs->arg4);
+    sysargs->arg4 = (void *) rc;
+}
+
+static void
+MailboxReceiveStub(USLOSS_Sysargs *sysargs)
+{
+    int size = (int) sysargs->arg3;
+    int rc = MailboxReceive((int) sysargs->arg1, sysargs->arg2, &size, (int) sysargs->arg4);
+    if ((rc == P1_SUCCESS) || (rc == P2_BUFFER_TOO_SMALL)) {
+        sysargs->arg3 = (void *) size;
+    }
+    sysargs->arg4 = (void *) rc;
+}
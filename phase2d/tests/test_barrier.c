@@ -0,0 +1,102 @@
+/*
+ * Tests barriers. Workers go through several phases, each of which they finish at the barrier,
+ * and check that every worker finished the previous phase before any of them starts the next.
+ */
+
+#include <phase1.h>
+#include <phase2.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libuser.h>
+
+#include "tester.h"
+#include "libuser2.h"
+#include "phase2Int.h"
+
+#define WORKERS 5
+#define PHASES 10
+
+static int barrier;
+static int passed = FALSE;
+static int finished[PHASES];    // # of workers that finished each phase
+
+static int
+Worker(void *arg)
+{
+    int rc;
+
+    for (int i = 0; i < PHASES; i++) {
+        if (i > 0) {
+            TEST(finished[i - 1], WORKERS);
+        }
+        finished[i]++;
+        rc = Sys_BarrierWait(barrier);
+        TEST_RC(rc, P1_SUCCESS);
+        TEST(finished[i], WORKERS);
+    }
+    return 12;
+}
+
+static int
+Waiter(void *arg)
+{
+    int rc = Sys_BarrierWait(barrier);
+    TEST_RC(rc, P1_SUCCESS);
+    return 12;
+}
+
+int
+P3_Startup(void *arg)
+{
+    int rc;
+    int pid;
+    int status;
+
+    rc = Sys_BarrierCreate("barrier", 0, &barrier);
+    TEST_RC(rc, P2_INVALID_ARGUMENT);
+    rc = Sys_BarrierCreate("barrier", WORKERS, &barrier);
+    TEST_RC(rc, P1_SUCCESS);
+    for (int i = 0; i < WORKERS; i++) {
+        rc = Sys_Spawn(MakeName("Worker", i), Worker, NULL, USLOSS_MIN_STACK, 3, &pid);
+        TEST_RC(rc, P1_SUCCESS);
+    }
+    for (int i = 0; i < WORKERS; i++) {
+        rc = Sys_Wait(&pid, &status);
+        TEST_RC(rc, P1_SUCCESS);
+        TEST(status, 12);
+    }
+    for (int i = 0; i < PHASES; i++) {
+        TEST(finished[i], WORKERS);
+    }
+
+    // a worker with a higher priority blocks at the barrier as soon as it is spawned
+    rc = Sys_BarrierCreate("pair", 2, &barrier);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_Spawn("Waiter", Waiter, NULL, USLOSS_MIN_STACK, 1, &pid);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_BarrierFree(barrier);
+    TEST_RC(rc, P1_BLOCKED_PROCESSES);
+    rc = Sys_BarrierWait(barrier);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_Wait(&pid, &status);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(status, 12);
+    rc = Sys_BarrierFree(barrier);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_BarrierWait(barrier);
+    TEST_RC(rc, P2_INVALID_ARGUMENT);
+    passed = TRUE;
+    return 0;
+}
+
+void test_setup(int argc, char **argv) {}
+
+void test_cleanup(int argc, char **argv) {
+    if (passed) {
+        PASSED_MSG();
+    }
+}
+
+void finish(int argc, char **argv) {}
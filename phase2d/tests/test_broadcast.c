@@ -0,0 +1,100 @@
+/*
+ * Tests Sys_CondBroadcast. Waiters released by a broadcast don't run while the broadcaster
+ * holds the lock, and then get the lock one at a time in the order they waited.
+ */
+
+#include <phase1.h>
+#include <phase2.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libuser.h>
+
+#include "tester.h"
+#include "libuser2.h"
+#include "phase2Int.h"
+
+#define WAITERS 4
+
+static int lock;
+static int cond;
+static int passed = FALSE;
+static int released = FALSE;
+static int order[WAITERS];
+static int numOrder = 0;
+
+static int
+Waiter(void *arg)
+{
+    int rc;
+
+    rc = Sys_LockAcquire(lock);
+    TEST_RC(rc, P1_SUCCESS);
+    while (!released) {
+        rc = Sys_CondWait(cond);
+        TEST_RC(rc, P1_SUCCESS);
+    }
+    order[numOrder++] = (int) arg;
+    rc = Sys_LockRelease(lock);
+    TEST_RC(rc, P1_SUCCESS);
+    return 12;
+}
+
+int
+P3_Startup(void *arg)
+{
+    int rc;
+    int pid, self;
+    int status;
+
+    Sys_GetPid(&self);
+    rc = Sys_LockCreate("lock", &lock);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_CondCreate("cond", lock, &cond);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_CondBroadcast(cond);
+    TEST_RC(rc, P1_LOCK_NOT_HELD);
+
+    // the waiters have a higher priority so they run and wait as soon as they are spawned
+    for (int i = 0; i < WAITERS; i++) {
+        rc = Sys_Spawn(MakeName("Waiter", i), Waiter, (void *) i, USLOSS_MIN_STACK, 1, &pid);
+        TEST_RC(rc, P1_SUCCESS);
+    }
+    rc = Sys_LockAcquireFast(lock, self);
+    TEST_RC(rc, P1_SUCCESS);
+    released = TRUE;
+    rc = Sys_CondBroadcast(cond);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(P2_LockWords[lock], P2_LOCK_WORD(self) | P2_LOCK_WAITERS);
+    TEST(numOrder, 0);
+    rc = Sys_CondFree(cond);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_LockReleaseFast(lock, self);
+    TEST_RC(rc, P1_SUCCESS);
+
+    for (int i = 0; i < WAITERS; i++) {
+        rc = Sys_Wait(&pid, &status);
+        TEST_RC(rc, P1_SUCCESS);
+        TEST(status, 12);
+    }
+    TEST(numOrder, WAITERS);
+    for (int i = 0; i < WAITERS; i++) {
+        TEST(order[i], i);
+    }
+    TEST(P2_LockWords[lock], P2_LOCK_FREE);
+    rc = Sys_LockFree(lock);
+    TEST_RC(rc, P1_SUCCESS);
+    passed = TRUE;
+    return 0;
+}
+
+void test_setup(int argc, char **argv) {}
+
+void test_cleanup(int argc, char **argv) {
+    if (passed) {
+        PASSED_MSG();
+    }
+}
+
+void finish(int argc, char **argv) {}
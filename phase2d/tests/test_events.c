@@ -0,0 +1,126 @@
+/*
+ * Tests Sys_WaitEvents. Each kind of event ends the wait and is reported, the lock of the
+ * condition variable is held again on return whichever event it was, and a child that
+ * terminated before the call is reported without waiting.
+ */
+
+#include <phase1.h>
+#include <phase2.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libuser.h>
+
+#include "tester.h"
+#include "libuser2.h"
+#include "phase2Int.h"
+
+#define TIMEOUT 100000      // microseconds
+
+static int lock;
+static int cond;
+static int passed = FALSE;
+
+static int
+Signaler(void *arg)
+{
+    int rc;
+
+    rc = Sys_LockAcquire(lock);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_CondSignal(cond);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_LockRelease(lock);
+    TEST_RC(rc, P1_SUCCESS);
+    return 12;
+}
+
+static int
+Child(void *arg)
+{
+    return 12;
+}
+
+int
+P3_Startup(void *arg)
+{
+    int rc;
+    int pid, child;
+    int status;
+    int event;
+    int start, end;
+
+    rc = Sys_LockCreate("lock", &lock);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_CondCreate("cond", lock, &cond);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_WaitEvents(-1, -1, FALSE, &event);
+    TEST_RC(rc, P2_INVALID_ARGUMENT);
+    rc = Sys_WaitEvents(cond, TIMEOUT, FALSE, &event);
+    TEST_RC(rc, P1_LOCK_NOT_HELD);
+
+    Sys_GetTimeOfDay(&start);
+    rc = Sys_WaitEvents(-1, TIMEOUT, TRUE, &event);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(event, P2_EVENT_TIMER);
+    Sys_GetTimeOfDay(&end);
+    TEST(end - start >= TIMEOUT, 1);
+
+    // the signaler has a lower priority so it only runs while this process waits
+    rc = Sys_LockAcquire(lock);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_Spawn("Signaler", Signaler, NULL, USLOSS_MIN_STACK, 3, &child);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_WaitEvents(cond, 100 * TIMEOUT, FALSE, &event);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(event, P2_EVENT_COND);
+    rc = Sys_LockRelease(lock);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_Wait(&pid, &status);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(pid, child);
+
+    rc = Sys_LockAcquire(lock);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_Spawn("Child", Child, NULL, USLOSS_MIN_STACK, 3, &child);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_WaitEvents(cond, 100 * TIMEOUT, TRUE, &event);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(event, P2_EVENT_CHILD);
+    rc = Sys_Wait(&pid, &status);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(pid, child);
+    TEST(status, 12);
+
+    // a timeout while waiting on the condition variable leaves it with no waiters
+    rc = Sys_WaitEvents(cond, TIMEOUT, FALSE, &event);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(event, P2_EVENT_TIMER);
+    rc = Sys_LockRelease(lock);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_CondFree(cond);
+    TEST_RC(rc, P1_SUCCESS);
+
+    // the child has a higher priority so it has terminated before the call
+    rc = Sys_Spawn("Child", Child, NULL, USLOSS_MIN_STACK, 1, &child);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_WaitEvents(-1, -1, TRUE, &event);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(event, P2_EVENT_CHILD);
+    rc = Sys_Wait(&pid, &status);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(pid, child);
+    passed = TRUE;
+    return 0;
+}
+
+void test_setup(int argc, char **argv) {}
+
+void test_cleanup(int argc, char **argv) {
+    if (passed) {
+        PASSED_MSG();
+    }
+}
+
+void finish(int argc, char **argv) {}
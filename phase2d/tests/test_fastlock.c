@@ -0,0 +1,165 @@
+/*
+ * Tests the user-level fast path for locks. An uncontended lock is acquired and released
+ * without setting P2_LOCK_WAITERS in its word, a contended lock is handed off through the
+ * kernel, and processes mixing the fast and system call paths exclude each other. A process
+ * can't release, wait on, or signal a lock another process acquired on the fast path.
+ */
+
+#include <phase1.h>
+#include <phase2.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libuser.h>
+
+#include "tester.h"
+#include "libuser2.h"
+#include "phase2Int.h"
+
+#define WORKERS 4
+#define ITERATIONS 1000
+
+static int lock;
+static int cond;
+static int passed = FALSE;
+static int counter = 0;
+
+static int
+Waiter(void *arg)
+{
+    int rc;
+    int pid;
+
+    Sys_GetPid(&pid);
+    rc = Sys_LockAcquireFast(lock, pid);
+    TEST_RC(rc, P1_SUCCESS);
+    // acquired through the kernel, so it must be released through the kernel
+    TEST(P2_LockWords[lock], P2_LOCK_WORD(pid) | P2_LOCK_WAITERS);
+    counter++;
+    rc = Sys_LockReleaseFast(lock, pid);
+    TEST_RC(rc, P1_SUCCESS);
+    return 12;
+}
+
+static int
+Thief(void *arg)
+{
+    int rc;
+    int pid;
+
+    Sys_GetPid(&pid);
+    rc = Sys_LockRelease(lock);
+    TEST_RC(rc, P1_LOCK_NOT_HELD);
+    rc = Sys_LockReleaseFast(lock, pid);
+    TEST_RC(rc, P1_LOCK_NOT_HELD);
+    rc = Sys_CondSignal(cond);
+    TEST_RC(rc, P1_LOCK_NOT_HELD);
+    rc = Sys_CondWait(cond);
+    TEST_RC(rc, P1_LOCK_NOT_HELD);
+    return 12;
+}
+
+static int
+Worker(void *arg)
+{
+    int rc;
+    int pid;
+
+    Sys_GetPid(&pid);
+    for (int i = 0; i < ITERATIONS; i++) {
+        int fast = (i + (int) arg) % 2;
+        rc = fast ? Sys_LockAcquireFast(lock, pid) : Sys_LockAcquire(lock);
+        TEST_RC(rc, P1_SUCCESS);
+        counter++;
+        rc = fast ? Sys_LockRelease(lock) : Sys_LockReleaseFast(lock, pid);
+        TEST_RC(rc, P1_SUCCESS);
+    }
+    return 12;
+}
+
+int
+P3_Startup(void *arg)
+{
+    int rc;
+    int pid, self;
+    int status;
+
+    Sys_GetPid(&self);
+    rc = Sys_LockCreate("fast", &lock);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(P2_LockWords[lock], P2_LOCK_FREE);
+    rc = Sys_CondCreate("fast", lock, &cond);
+    TEST_RC(rc, P1_SUCCESS);
+
+    rc = Sys_LockAcquireFast(lock, self);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(P2_LockWords[lock], P2_LOCK_WORD(self));
+    TEST(P2_LOCK_HOLDER(P2_LockWords[lock]), self);
+    rc = Sys_LockReleaseFast(lock, self);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(P2_LockWords[lock], P2_LOCK_FREE);
+    rc = Sys_LockReleaseFast(lock, self);
+    TEST_RC(rc, P1_LOCK_NOT_HELD);
+
+    // the thief has a higher priority so it runs while this process holds the lock
+    rc = Sys_LockAcquireFast(lock, self);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_Spawn("Thief", Thief, NULL, USLOSS_MIN_STACK, 1, &pid);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_Wait(&pid, &status);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(status, 12);
+    TEST(P2_LockWords[lock], P2_LOCK_WORD(self));
+    rc = Sys_LockReleaseFast(lock, self);
+    TEST_RC(rc, P1_SUCCESS);
+
+    // the waiter has a higher priority so it runs and blocks as soon as it is spawned
+    rc = Sys_LockAcquireFast(lock, self);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_Spawn("Waiter", Waiter, NULL, USLOSS_MIN_STACK, 1, &pid);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(P2_LockWords[lock], P2_LOCK_WORD(self) | P2_LOCK_WAITERS);
+    TEST(counter, 0);
+    rc = Sys_LockReleaseFast(lock, self);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_Wait(&pid, &status);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(status, 12);
+    TEST(counter, 1);
+    TEST(P2_LockWords[lock], P2_LOCK_FREE);
+
+    counter = 0;
+    for (int i = 0; i < WORKERS; i++) {
+        rc = Sys_Spawn(MakeName("Worker", i), Worker, (void *) i, USLOSS_MIN_STACK, 3, &pid);
+        TEST_RC(rc, P1_SUCCESS);
+    }
+    for (int i = 0; i < WORKERS; i++) {
+        rc = Sys_Wait(&pid, &status);
+        TEST_RC(rc, P1_SUCCESS);
+        TEST(status, 12);
+    }
+    TEST(counter, WORKERS * ITERATIONS);
+
+    rc = Sys_CondFree(cond);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_LockFree(lock);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(P2_LockWords[lock], P2_LOCK_INVALID);
+    rc = Sys_LockAcquireFast(lock, self);
+    TEST_RC(rc, P1_INVALID_LOCK);
+    rc = Sys_LockAcquireFast(-1, self);
+    TEST_RC(rc, P1_INVALID_LOCK);
+    passed = TRUE;
+    return 0;
+}
+
+void test_setup(int argc, char **argv) {}
+
+void test_cleanup(int argc, char **argv) {
+    if (passed) {
+        PASSED_MSG();
+    }
+}
+
+void finish(int argc, char **argv) {}
@@ -0,0 +1,132 @@
+/*
+ * Tests priority inheritance. Low holds a lock while its write to a sector waits behind a long
+ * write on another track, with a write from Hog to the same sector queued ahead of it. Hog has
+ * a higher priority than Low, so without inheritance Hog's write is done first and Low's data
+ * ends up on the disk. When High blocks on the lock, Low's queued write inherits High's priority
+ * and is done before Hog's, so Hog's data ends up on the disk.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <assert.h>
+#include <libuser.h>
+#include <libdisk.h>
+
+#include "tester.h"
+#include "libuser2.h"
+#include "phase2Int.h"
+
+#define TRACKS 10
+#define DISKUNIT 0
+#define SECTOR (5 * USLOSS_DISK_TRACK_SIZE)
+
+static int lock;
+static int passed = FALSE;
+
+static int
+Busy(void *arg)
+{
+    static char buffer[USLOSS_DISK_TRACK_SIZE * USLOSS_DISK_SECTOR_SIZE];
+    int rc;
+
+    rc = Sys_DiskWrite(buffer, 9 * USLOSS_DISK_TRACK_SIZE, USLOSS_DISK_TRACK_SIZE, DISKUNIT);
+    TEST_RC(rc, P1_SUCCESS);
+    return 12;
+}
+
+static int
+Writer(void *arg)
+{
+    char buffer[USLOSS_DISK_SECTOR_SIZE];
+    int holder = (arg != NULL);
+    int rc;
+
+    memset(buffer, holder ? 'L' : 'H', sizeof(buffer));
+    if (holder) {
+        rc = Sys_LockAcquire(lock);
+        TEST_RC(rc, P1_SUCCESS);
+    }
+    rc = Sys_DiskWrite(buffer, SECTOR, 1, DISKUNIT);
+    TEST_RC(rc, P1_SUCCESS);
+    if (holder) {
+        rc = Sys_LockRelease(lock);
+        TEST_RC(rc, P1_SUCCESS);
+    }
+    return 12;
+}
+
+static int
+High(void *arg)
+{
+    int rc;
+
+    rc = Sys_LockAcquire(lock);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_LockRelease(lock);
+    TEST_RC(rc, P1_SUCCESS);
+    return 12;
+}
+
+static int
+Trigger(void *arg)
+{
+    int rc, pid, status;
+
+    // High runs and blocks on the lock as soon as it is spawned
+    rc = Sys_Spawn("High", High, NULL, USLOSS_MIN_STACK, 1, &pid);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_Wait(&pid, &status);
+    TEST_RC(rc, P1_SUCCESS);
+    return 12;
+}
+
+int
+P3_Startup(void *arg)
+{
+    char buffer[USLOSS_DISK_SECTOR_SIZE];
+    int rc, pid, status;
+
+    rc = Sys_LockCreate("lock", &lock);
+    TEST_RC(rc, P1_SUCCESS);
+
+    // they run in this order when P3_Startup waits, each until it blocks
+    rc = Sys_Spawn("Busy", Busy, NULL, USLOSS_MIN_STACK, 4, &pid);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_Spawn("Hog", Writer, NULL, USLOSS_MIN_STACK, 4, &pid);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_Spawn("Low", Writer, (void *) 1, USLOSS_MIN_STACK, 5, &pid);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_Spawn("Trigger", Trigger, NULL, USLOSS_MIN_STACK, 5, &pid);
+    TEST_RC(rc, P1_SUCCESS);
+    for (int i = 0; i < 4; i++) {
+        rc = Sys_Wait(&pid, &status);
+        TEST_RC(rc, P1_SUCCESS);
+        TEST(status, 12);
+    }
+
+    rc = Sys_DiskRead(buffer, SECTOR, 1, DISKUNIT);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(buffer[0], 'H');
+    passed = TRUE;
+    return 0;
+}
+
+void test_setup(int argc, char **argv) {
+    int rc;
+
+    DeleteAllDisks();
+    rc = Disk_Create(NULL, DISKUNIT, TRACKS);
+    assert(rc == 0);
+}
+
+void test_cleanup(int argc, char **argv) {
+    DeleteAllDisks();
+    if (passed) {
+        PASSED_MSG();
+    }
+}
+
+void finish(int argc, char **argv) {}
@@ -0,0 +1,130 @@
+/*
+ * Tests lock contention statistics. Counts uncontended, contended, and fast-path acquires of a
+ * lock and a wait on a condition variable, and dumps the statistics with DumpLocks.
+ */
+
+#include <phase1.h>
+#include <phase2.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libuser.h>
+
+#include "tester.h"
+#include "libuser2.h"
+#include "phase2Int.h"
+
+static int lock;
+static int cond;
+static int passed = FALSE;
+static int signaled = FALSE;
+
+static int
+Child(void *arg)
+{
+    int rc;
+
+    rc = Sys_LockAcquire(lock);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_LockRelease(lock);
+    TEST_RC(rc, P1_SUCCESS);
+    return 12;
+}
+
+static int
+Waiter(void *arg)
+{
+    int rc;
+
+    rc = Sys_LockAcquire(lock);
+    TEST_RC(rc, P1_SUCCESS);
+    while (!signaled) {
+        rc = Sys_CondWait(cond);
+        TEST_RC(rc, P1_SUCCESS);
+    }
+    rc = Sys_LockRelease(lock);
+    TEST_RC(rc, P1_SUCCESS);
+    return 12;
+}
+
+int
+P3_Startup(void *arg)
+{
+    int rc;
+    int pid;
+    int child;
+    int status;
+    P2_LockStats stats;
+
+    Sys_GetPid(&pid);
+    rc = Sys_LockCreate("lock", &lock);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_CondCreate("cond", lock, &cond);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_LockStats(lock, NULL);
+    TEST_RC(rc, P2_NULL_ADDRESS);
+    rc = Sys_LockStats(lock + 1, &stats);
+    TEST_RC(rc, P1_INVALID_LOCK);
+
+    // the child has a higher priority so it runs and blocks on the lock as soon as it is spawned
+    rc = Sys_LockAcquire(lock);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_Spawn("Child", Child, NULL, USLOSS_MIN_STACK, 1, &child);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_LockRelease(lock);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_Wait(&child, &status);
+    TEST_RC(rc, P1_SUCCESS);
+
+    rc = Sys_LockAcquireFast(lock, pid);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_LockReleaseFast(lock, pid);
+    TEST_RC(rc, P1_SUCCESS);
+
+    rc = Sys_LockStats(lock, &stats);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(strcmp(stats.name, "lock"), 0);
+    TEST(stats.acquires, 3);
+    TEST(stats.contended, 1);
+    TEST(stats.maxWait <= stats.totalWait, 1);
+    TEST(stats.maxHold > 0, 1);
+    TEST(stats.maxHolder, pid);
+
+    rc = Sys_Spawn("Waiter", Waiter, NULL, USLOSS_MIN_STACK, 1, &child);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_LockAcquire(lock);
+    TEST_RC(rc, P1_SUCCESS);
+    signaled = TRUE;
+    rc = Sys_CondSignal(cond);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_LockRelease(lock);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_Wait(&child, &status);
+    TEST_RC(rc, P1_SUCCESS);
+
+    rc = Sys_CondStats(cond, &stats);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(strcmp(stats.name, "cond"), 0);
+    TEST(stats.acquires, 1);
+    TEST(stats.contended, 1);
+    TEST(stats.maxHolder, child);
+    rc = Sys_LockStats(lock, &stats);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(stats.acquires, 6);
+    TEST(stats.contended, 2);
+
+    DumpLocks();
+    passed = TRUE;
+    return 0;
+}
+
+void test_setup(int argc, char **argv) {}
+
+void test_cleanup(int argc, char **argv) {
+    if (passed) {
+        PASSED_MSG();
+    }
+}
+
+void finish(int argc, char **argv) {}
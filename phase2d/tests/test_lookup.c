@@ -0,0 +1,131 @@
+/*
+ * Tests looking up locks and condition variables by name. A child finds the objects its parent
+ * created without being passed their ids, freed names can no longer be found and can be reused,
+ * and many names hashed into the same table are all found.
+ */
+
+#include <phase1.h>
+#include <phase2.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libuser.h>
+
+#include "tester.h"
+#include "libuser2.h"
+#include "phase2Int.h"
+
+#define NUM_LOCKS 500
+
+static int passed = FALSE;
+static int locks[NUM_LOCKS];
+
+static int
+Child(void *arg)
+{
+    int lid, vid;
+    int rc;
+
+    rc = Sys_LockLookup("well-known", &lid);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_CondLookup("well-known", &vid);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_LockAcquire(lid);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_CondSignal(vid);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_LockRelease(lid);
+    TEST_RC(rc, P1_SUCCESS);
+    return 12;
+}
+
+int
+P3_Startup(void *arg)
+{
+    int rc;
+    int lid, vid, id;
+    int pid;
+    int status;
+
+    rc = Sys_LockLookup(NULL, &id);
+    TEST_RC(rc, P1_NAME_IS_NULL);
+    rc = Sys_LockLookup("well-known", &id);
+    TEST_RC(rc, P1_INVALID_LOCK);
+    rc = Sys_CondLookup("well-known", &id);
+    TEST_RC(rc, P1_INVALID_COND);
+
+    // locks and condition variables have separate names
+    rc = Sys_LockCreate("well-known", &lid);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_CondCreate("well-known", lid, &vid);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_LockCreate("well-known", &id);
+    TEST_RC(rc, P1_DUPLICATE_NAME);
+    rc = Sys_CondCreate("well-known", lid, &id);
+    TEST_RC(rc, P1_DUPLICATE_NAME);
+    rc = Sys_LockLookup("well-known", &id);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(id, lid);
+    rc = Sys_CondLookup("well-known", &id);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(id, vid);
+
+    // the child runs and signals while the parent waits
+    rc = Sys_LockAcquire(lid);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_Spawn("Child", Child, NULL, USLOSS_MIN_STACK, 3, &pid);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_CondWait(vid);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_LockRelease(lid);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_Wait(&pid, &status);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(status, 12);
+
+    rc = Sys_CondFree(vid);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_CondLookup("well-known", &id);
+    TEST_RC(rc, P1_INVALID_COND);
+    rc = Sys_LockFree(lid);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_LockLookup("well-known", &id);
+    TEST_RC(rc, P1_INVALID_LOCK);
+    rc = Sys_LockCreate("well-known", &lid);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_LockLookup("well-known", &id);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(id, lid);
+
+    for (int i = 0; i < NUM_LOCKS; i++) {
+        rc = Sys_LockCreate(MakeName("lock", i), &locks[i]);
+        TEST_RC(rc, P1_SUCCESS);
+    }
+    // free every other lock so the rest are unlinked from the middle of their buckets
+    for (int i = 0; i < NUM_LOCKS; i += 2) {
+        rc = Sys_LockFree(locks[i]);
+        TEST_RC(rc, P1_SUCCESS);
+    }
+    for (int i = 0; i < NUM_LOCKS; i++) {
+        rc = Sys_LockLookup(MakeName("lock", i), &id);
+        if (i % 2 == 0) {
+            TEST_RC(rc, P1_INVALID_LOCK);
+        } else {
+            TEST_RC(rc, P1_SUCCESS);
+            TEST(id, locks[i]);
+        }
+    }
+    passed = TRUE;
+    return 0;
+}
+
+void test_setup(int argc, char **argv) {}
+
+void test_cleanup(int argc, char **argv) {
+    if (passed) {
+        PASSED_MSG();
+    }
+}
+
+void finish(int argc, char **argv) {}
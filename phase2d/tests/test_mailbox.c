@@ -0,0 +1,184 @@
+/*
+ * Tests mailboxes. Messages are received in the order they were sent, a message sent to a
+ * waiting receiver is handed to it directly, a sender waiting for a full mailbox is unblocked
+ * when a slot frees up, a mailbox with no slots passes messages between processes, a message too
+ * large for the receiver's buffer isn't received, and the conditional operations don't block.
+ */
+
+#include <phase1.h>
+#include <phase2.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libuser.h>
+
+#include "tester.h"
+#include "libuser2.h"
+#include "phase2Int.h"
+
+#define SLOTS 2
+#define SIZE 16
+
+static int mbox;
+static int passed = FALSE;
+
+static int
+Receiver(void *arg)
+{
+    char buffer[SIZE];
+    int size = sizeof(buffer);
+    int rc;
+
+    rc = Sys_MailboxReceive(mbox, buffer, &size);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(size, strlen((char *) arg) + 1);
+    TEST(strcmp(buffer, (char *) arg), 0);
+    return 12;
+}
+
+static int
+SmallReceiver(void *arg)
+{
+    char buffer[2];
+    int size = sizeof(buffer);
+    int rc;
+
+    rc = Sys_MailboxReceive(mbox, buffer, &size);
+    TEST_RC(rc, P2_BUFFER_TOO_SMALL);
+    TEST(size, strlen((char *) arg) + 1);
+    return 12;
+}
+
+static int
+Sender(void *arg)
+{
+    int rc;
+
+    rc = Sys_MailboxSend(mbox, arg, strlen((char *) arg) + 1);
+    TEST_RC(rc, P1_SUCCESS);
+    return 12;
+}
+
+static void
+Receive(char *expected)
+{
+    char buffer[SIZE];
+    int size = sizeof(buffer);
+    int rc;
+
+    rc = Sys_MailboxCondReceive(mbox, buffer, &size);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(size, strlen(expected) + 1);
+    TEST(strcmp(buffer, expected), 0);
+}
+
+int
+P3_Startup(void *arg)
+{
+    char buffer[SIZE];
+    int size;
+    int rc;
+    int pid;
+    int status;
+
+    rc = Sys_MailboxCreate("mbox", -1, SIZE, &mbox);
+    TEST_RC(rc, P2_INVALID_ARGUMENT);
+    rc = Sys_MailboxCreate("mbox", SLOTS, 0, &mbox);
+    TEST_RC(rc, P2_INVALID_ARGUMENT);
+    rc = Sys_MailboxCreate("mbox", SLOTS, SIZE, &mbox);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_MailboxSend(mbox, buffer, SIZE + 1);
+    TEST_RC(rc, P2_INVALID_ARGUMENT);
+    size = sizeof(buffer);
+    rc = Sys_MailboxCondReceive(mbox, buffer, &size);
+    TEST_RC(rc, P2_WOULD_BLOCK);
+
+    // messages are received in order and a full mailbox doesn't take more
+    rc = Sys_MailboxCondSend(mbox, "one", 4);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_MailboxSend(mbox, "two", 4);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_MailboxCondSend(mbox, "three", 6);
+    TEST_RC(rc, P2_WOULD_BLOCK);
+    Receive("one");
+
+    // a message larger than the buffer stays in the mailbox and the receiver gets its size
+    size = 2;
+    rc = Sys_MailboxReceive(mbox, buffer, &size);
+    TEST_RC(rc, P2_BUFFER_TOO_SMALL);
+    TEST(size, 4);
+    Receive("two");
+
+    // the children have a higher priority so they run and block as soon as they are spawned
+    rc = Sys_Spawn("Receiver", Receiver, "direct", USLOSS_MIN_STACK, 1, &pid);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_MailboxFree(mbox);
+    TEST_RC(rc, P1_BLOCKED_PROCESSES);
+    rc = Sys_MailboxSend(mbox, "direct", 7);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_Wait(&pid, &status);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(status, 12);
+    size = sizeof(buffer);
+    rc = Sys_MailboxCondReceive(mbox, buffer, &size);
+    TEST_RC(rc, P2_WOULD_BLOCK);
+
+    rc = Sys_MailboxSend(mbox, "one", 4);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_MailboxSend(mbox, "two", 4);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_Spawn("Sender", Sender, "three", USLOSS_MIN_STACK, 1, &pid);
+    TEST_RC(rc, P1_SUCCESS);
+    Receive("one");
+    Receive("two");
+    Receive("three");
+    rc = Sys_Wait(&pid, &status);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(status, 12);
+    rc = Sys_MailboxFree(mbox);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_MailboxSend(mbox, "one", 4);
+    TEST_RC(rc, P2_INVALID_ARGUMENT);
+
+    // a mailbox with no slots only passes messages to waiting receivers and from waiting senders
+    rc = Sys_MailboxCreate("zero", 0, SIZE, &mbox);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_MailboxCondSend(mbox, "one", 4);
+    TEST_RC(rc, P2_WOULD_BLOCK);
+    rc = Sys_Spawn("Sender", Sender, "one", USLOSS_MIN_STACK, 1, &pid);
+    TEST_RC(rc, P1_SUCCESS);
+    Receive("one");
+    rc = Sys_Wait(&pid, &status);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_Spawn("Receiver", Receiver, "two", USLOSS_MIN_STACK, 1, &pid);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_MailboxCondSend(mbox, "two", 4);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_Wait(&pid, &status);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(status, 12);
+
+    // a waiting receiver whose buffer is too small only gets the message's size
+    rc = Sys_Spawn("SmallReceiver", SmallReceiver, "three", USLOSS_MIN_STACK, 1, &pid);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_MailboxCondSend(mbox, "three", 6);
+    TEST_RC(rc, P2_WOULD_BLOCK);
+    rc = Sys_Wait(&pid, &status);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(status, 12);
+    rc = Sys_MailboxFree(mbox);
+    TEST_RC(rc, P1_SUCCESS);
+    passed = TRUE;
+    return 0;
+}
+
+void test_setup(int argc, char **argv) {}
+
+void test_cleanup(int argc, char **argv) {
+    if (passed) {
+        PASSED_MSG();
+    }
+}
+
+void finish(int argc, char **argv) {}
@@ -0,0 +1,112 @@
+/*
+ * Tests reader-writer locks. Readers share the lock, a writer waits for the readers, and a
+ * reader that arrives after a waiting writer doesn't overtake it.
+ */
+
+#include <phase1.h>
+#include <phase2.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libuser.h>
+
+#include "tester.h"
+#include "libuser2.h"
+#include "phase2Int.h"
+
+static int rw;
+static int passed = FALSE;
+static char order[10];
+static int numOrder = 0;
+
+static int
+Reader(void *arg)
+{
+    int rc;
+
+    rc = Sys_RwLockRead(rw);
+    TEST_RC(rc, P1_SUCCESS);
+    order[numOrder++] = 'R';
+    rc = Sys_RwLockRelease(rw);
+    TEST_RC(rc, P1_SUCCESS);
+    return 12;
+}
+
+static int
+Writer(void *arg)
+{
+    int rc;
+
+    rc = Sys_RwLockWrite(rw);
+    TEST_RC(rc, P1_SUCCESS);
+    order[numOrder++] = 'W';
+    rc = Sys_RwLockRelease(rw);
+    TEST_RC(rc, P1_SUCCESS);
+    return 12;
+}
+
+int
+P3_Startup(void *arg)
+{
+    int rc;
+    int pid;
+    int status;
+
+    rc = Sys_RwLockCreate("rw", &rw);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_RwLockCreate("rw", &pid);
+    TEST_RC(rc, P1_DUPLICATE_NAME);
+    rc = Sys_RwLockRelease(rw);
+    TEST_RC(rc, P1_LOCK_NOT_HELD);
+
+    // the children have a higher priority so they run as soon as they are spawned
+    rc = Sys_RwLockRead(rw);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_RwLockRead(rw);
+    TEST_RC(rc, P1_LOCK_HELD);
+    rc = Sys_Spawn("Reader1", Reader, NULL, USLOSS_MIN_STACK, 1, &pid);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(numOrder, 1);
+    rc = Sys_Spawn("Writer", Writer, NULL, USLOSS_MIN_STACK, 1, &pid);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_Spawn("Reader2", Reader, NULL, USLOSS_MIN_STACK, 1, &pid);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(numOrder, 1);
+    rc = Sys_RwLockFree(rw);
+    TEST_RC(rc, P1_BLOCKED_PROCESSES);
+    rc = Sys_RwLockRelease(rw);
+    TEST_RC(rc, P1_SUCCESS);
+    for (int i = 0; i < 3; i++) {
+        rc = Sys_Wait(&pid, &status);
+        TEST_RC(rc, P1_SUCCESS);
+        TEST(status, 12);
+    }
+    TEST(numOrder, 3);
+    TEST(strncmp(order, "RWR", 3), 0);
+
+    rc = Sys_RwLockWrite(rw);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_RwLockFree(rw);
+    TEST_RC(rc, P1_LOCK_HELD);
+    rc = Sys_RwLockRelease(rw);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_RwLockFree(rw);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_RwLockRead(rw);
+    TEST_RC(rc, P2_INVALID_ARGUMENT);
+    rc = Sys_RwLockCreate("rw", &rw);
+    TEST_RC(rc, P1_SUCCESS);
+    passed = TRUE;
+    return 0;
+}
+
+void test_setup(int argc, char **argv) {}
+
+void test_cleanup(int argc, char **argv) {
+    if (passed) {
+        PASSED_MSG();
+    }
+}
+
+void finish(int argc, char **argv) {}
@@ -0,0 +1,105 @@
+/*
+ * Tests counting semaphores. One V wakes several waiters, a waiter that needs more units than
+ * are available isn't overtaken, and try-P doesn't block.
+ */
+
+#include <phase1.h>
+#include <phase2.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libuser.h>
+
+#include "tester.h"
+#include "libuser2.h"
+#include "phase2Int.h"
+
+#define CONSUMERS 3
+
+static int sem;
+static int passed = FALSE;
+static int done = 0;
+
+static int
+Consumer(void *arg)
+{
+    int count = (int) arg;
+    int rc;
+
+    rc = Sys_SemP(sem, count);
+    TEST_RC(rc, P1_SUCCESS);
+    done += count;
+    return 12;
+}
+
+int
+P3_Startup(void *arg)
+{
+    int rc;
+    int pid;
+    int status;
+
+    rc = Sys_SemCreate("sem", -1, &sem);
+    TEST_RC(rc, P2_INVALID_ARGUMENT);
+    rc = Sys_SemCreate("sem", 0, &sem);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_SemTryP(sem, 1);
+    TEST_RC(rc, P2_WOULD_BLOCK);
+    rc = Sys_SemV(sem, 2);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_SemTryP(sem, 2);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_SemTryP(sem, 1);
+    TEST_RC(rc, P2_WOULD_BLOCK);
+    rc = Sys_SemP(sem, 0);
+    TEST_RC(rc, P2_INVALID_ARGUMENT);
+
+    // the consumers have a higher priority so they run and block as soon as they are spawned
+    for (int i = 0; i < CONSUMERS; i++) {
+        rc = Sys_Spawn(MakeName("Consumer", i), Consumer, (void *) 1, USLOSS_MIN_STACK, 1, &pid);
+        TEST_RC(rc, P1_SUCCESS);
+    }
+    rc = Sys_Spawn("Big", Consumer, (void *) 2, USLOSS_MIN_STACK, 1, &pid);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(done, 0);
+    rc = Sys_SemFree(sem);
+    TEST_RC(rc, P1_BLOCKED_PROCESSES);
+
+    // one V releases all the consumers but not Big, and nothing can overtake Big
+    rc = Sys_SemV(sem, CONSUMERS + 1);
+    TEST_RC(rc, P1_SUCCESS);
+    for (int i = 0; i < CONSUMERS; i++) {
+        rc = Sys_Wait(&pid, &status);
+        TEST_RC(rc, P1_SUCCESS);
+        TEST(status, 12);
+    }
+    TEST(done, CONSUMERS);
+    rc = Sys_SemTryP(sem, 1);
+    TEST_RC(rc, P2_WOULD_BLOCK);
+    rc = Sys_SemV(sem, 1);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_Wait(&pid, &status);
+    TEST_RC(rc, P1_SUCCESS);
+    TEST(status, 12);
+    TEST(done, CONSUMERS + 2);
+
+    rc = Sys_SemTryP(sem, 1);
+    TEST_RC(rc, P2_WOULD_BLOCK);
+    rc = Sys_SemFree(sem);
+    TEST_RC(rc, P1_SUCCESS);
+    rc = Sys_SemV(sem, 1);
+    TEST_RC(rc, P2_INVALID_ARGUMENT);
+    passed = TRUE;
+    return 0;
+}
+
+void test_setup(int argc, char **argv) {}
+
+void test_cleanup(int argc, char **argv) {
+    if (passed) {
+        PASSED_MSG();
+    }
+}
+
+void finish(int argc, char **argv) {}
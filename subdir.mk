@@ -13,6 +13,9 @@
 #       make testN.v    (runs valgrind on testN and puts output in testN.v)
 #       make valgrind   (makes all testN.v files, i.e. runs valgrind on all tests)
 #
+#       make bench      (runs all benchmarks in virtual time for each workload and puts
+#                        their results in bench.out)
+#
 #       make clean      (removes all files created by this Makefile)
 
 # sh is dash on lectura which breaks things
@@ -38,6 +41,13 @@ SRCS = $(wildcard *.c)
 # Tests are in the "tests" directory.
 TESTS = $(patsubst %.c,%,$(wildcard tests/*.c))
 
+# Benchmarks are in the "bench" directory. They are run with -R so that USLOSS uses virtual
+# time and the results are deterministic.
+BENCHES = $(patsubst %.c,%,$(wildcard bench/*.c))
+BENCHFLAGS = -R
+BENCH_WORKLOADS = random sequential hotspot mixed
+WORKLOAD_BENCHES = $(filter bench/bench_disk,$(BENCHES))
+
 # Change this if you want to change the arguments to valgrind.
 VGFLAGS = --track-origins=yes --leak-check=full --max-stackframe=100000
 
@@ -50,8 +60,10 @@ LIBS = -lusloss$(USLOSS_VERSION) \
 	   -lphase1c-$(PHASE1C_VERSION) \
 	   -lphase1d-$(PHASE1D_VERSION)
 
-LDFLAGS += -L. -L$(PREFIX)/cs452/lib -L$(PREFIX)/lib 
+LDFLAGS += -L.
 
+# The earlier phases in this tree are searched before the installed libraries, so that the
+# hooks they export to later phases are linked in.
 ifeq ($(PHASE), phase2b)
 	LIBS += -lphase2a-$(PHASE2A_VERSION)
 	LDFLAGS += -L../phase2a
@@ -66,6 +78,8 @@ else ifeq ($(PHASE), phase2d)
 	LDFLAGS += -L../phase2a -L../phase2b -L../phase2c
 endif
 
+LDFLAGS += -L$(PREFIX)/cs452/lib -L$(PREFIX)/lib
+
 LIBS += -l$(PHASE)-$(VERSION) 
 
 # Change this if you want change which flags are passed to the C compiler.
@@ -103,6 +117,8 @@ TOBJS = ${TESTS:=.o}
 TDEPS = ${TOBJS:.o=.d}
 TOUTS = ${TESTS:=.out}
 TVS = ${TESTS:=.v}
+BOBJS = ${BENCHES:=.o}
+BDEPS = ${BOBJS:.o=.d}
 STUBS = ../p3/p3stubs.o
 
 # The following is to deal with circular dependencies between the USLOSS and phase1
@@ -114,7 +130,7 @@ else
 	LIBFLAGS = -Wl,--start-group $(LIBS) -Wl,--end-group
 endif
 
-.PHONY: $(PHASE) tests
+.PHONY: $(PHASE) tests bench
 
 %.d: %.c
 	$(CC) -c $(CFLAGS) -MM -MF $@ $<
@@ -140,8 +156,25 @@ tests: $(TOUTS)
 $(TESTS):   %: $(TARGET) %.o $(STUBS)
 	$(LD) $(LDFLAGS) -o $@ $@.o $(STUBS) $(LIBFLAGS)
 
+$(BENCHES): %: $(TARGET) %.o $(STUBS)
+	$(LD) $(LDFLAGS) -o $@ $@.o $(STUBS) $(LIBFLAGS)
+
+# Each benchmark prints lines starting with "BENCH". The workload benchmark is run once per
+# workload, the others once.
+.NOTPARALLEL: bench
+bench: $(BENCHES)
+	@(for b in $(WORKLOAD_BENCHES); do \
+		for w in $(BENCH_WORKLOADS); do \
+			BENCH_WORKLOAD=$$w ./$$b $(BENCHFLAGS) 2>&1 | grep '^BENCH'; \
+		done; \
+	done; \
+	for b in $(filter-out $(WORKLOAD_BENCHES),$(BENCHES)); do \
+		./$$b $(BENCHFLAGS) 2>&1 | grep '^BENCH'; \
+	done) | tee bench.out
+
 clean:
-	rm -f $(COBJS) $(TARGET) $(TOBJS) $(TESTS) $(DEPS) $(TDEPS) $(TVS) *.out tests/*.out tests/*.err
+	rm -f $(COBJS) $(TARGET) $(TOBJS) $(TESTS) $(DEPS) $(TDEPS) $(TVS) *.out tests/*.out tests/*.err \
+	      $(BOBJS) $(BENCHES) $(BDEPS)
 
 %.d: %.c
 	$(CC) -c $(CFLAGS) -MM -MF $@ $<
@@ -156,3 +189,4 @@ valgrind: $(TVS)
 
 -include $(DEPS) 
 -include $(TDEPS)
+-include $(BDEPS)
@@ -42,7 +42,11 @@ static char *errors[] = {
     "Invalid first sector.",
     "Invalid number of sectors.",
     "Address is NULL.",
-    "Process was not spawned."
+    "Process was not spawned.",
+    "Invalid argument.",
+    "Swap area is full.",
+    "Operation would block.",
+    "Too many objects."
 };
 
 static int numCodes = sizeof(errors) / sizeof(char *);
@@ -60,6 +64,20 @@ ErrorCodeToString(int code)
 
 #ifndef PHASE1A
 
+#if defined(PHASE2A) || defined(PHASE2B) || defined(PHASE2C) || defined(PHASE2D)
+#include "libuser2.h"
+#endif
+
+static void
+DumpProcess(int pid, P1_ProcInfo *info)
+{
+    USLOSS_Console("%10s %3d %8s %3d %4d %3d %3d %3d ", info->name, pid, states[info->state], info->priority, info->cpu, info->lid, info->vid, info->parent);
+    for (int j = 0; j < info->numChildren; j++) {
+      USLOSS_Console("%d ", info->children[j]);
+    }
+    USLOSS_Console("\n");
+}
+
 static void
 DumpProcesses(void)
 {
@@ -67,6 +85,20 @@ DumpProcesses(void)
     int mode = USLOSS_PsrGet() & USLOSS_PSR_CURRENT_MODE;
 
     USLOSS_Console("%10s %3s %8s %3s %4s %3s %3s %3s %s\n", "Name", "PID", "State", "Pri", "CPU", "LID", "VID", "Par", "Children");
+#ifdef SYS_GETALLPROCINFO
+    if (mode == 0) {
+        // user mode, one system call for the whole table, or one per process if that fails
+        static P2_ProcInfo infos[P1_MAXPROC];
+        int count;
+        rc = Sys_GetAllProcInfo(infos, P1_MAXPROC, -1, -1, &count);
+        if (rc == P1_SUCCESS) {
+            for (int i = 0; i < count; i++) {
+                DumpProcess(infos[i].pid, &infos[i].info);
+            }
+            return;
+        }
+    }
+#endif
     for (int i = 0; i < P1_MAXPROC; i++) {
         P1_ProcInfo info;
         memset(&info, '\0', sizeof(info));
@@ -77,11 +109,53 @@ DumpProcesses(void)
             rc = P1_GetProcInfo(i, &info);
         }
         if ((rc == P1_SUCCESS) && (info.state != P1_STATE_FREE)) {
-            USLOSS_Console("%10s %3d %8s %3d %4d %3d %3d %3d ", info.name, i, states[info.state], info.priority, info.cpu, info.lid, info.vid, info.parent);
-            for (int j = 0; j < info.numChildren; j++) {
-              USLOSS_Console("%d ", info.children[j]);
-            }
-            USLOSS_Console("\n");
+            DumpProcess(i, &info);
+        }
+    }
+}
+
+#endif
+
+#ifdef PHASE2D
+
+#include "phase2Int.h"
+
+static void
+DumpLockStats(char *type, int id, P2_LockStats *stats)
+{
+    USLOSS_Console("%4s %10s %4d %6d %6d %9d %8d %9d %8d %6d\n", type, stats->name, id,
+                   stats->acquires, stats->contended, stats->totalWait, stats->maxWait,
+                   stats->totalHold, stats->maxHold, stats->maxHolder);
+}
+
+static void
+DumpLocks(void)
+{
+    int rc;
+    int mode = USLOSS_PsrGet() & USLOSS_PSR_CURRENT_MODE;
+    P2_LockStats stats;
+
+    USLOSS_Console("%4s %10s %4s %6s %6s %9s %8s %9s %8s %6s\n", "Type", "Name", "ID", "Acq",
+                   "Cont", "TotWait", "MaxWait", "TotHold", "MaxHold", "Holder");
+    for (int i = 0; i < P1_MAXLOCKS; i++) {
+        if (mode == 0) {
+            // user mode
+            rc = Sys_LockStats(i, &stats);
+        } else {
+            rc = P2LockStats(i, FALSE, &stats);
+        }
+        if (rc == P1_SUCCESS) {
+            DumpLockStats("Lock", i, &stats);
+        }
+    }
+    for (int i = 0; i < P1_MAXCONDS; i++) {
+        if (mode == 0) {
+            rc = Sys_CondStats(i, &stats);
+        } else {
+            rc = P2LockStats(i, TRUE, &stats);
+        }
+        if (rc == P1_SUCCESS) {
+            DumpLockStats("Cond", i, &stats);
         }
     }
 }